@@ -1,12 +1,58 @@
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 using namespace std;
 
 // Function to trim whitespace
@@ -34,976 +80,6365 @@ string hashPassword(const string &password)
     return ss.str();
 }
 
-// Product Class
-class Product
+// 64-bit FNV-1a hash used by the in-memory indexes and snapshot checksums.
+// Pass a previous result as the seed to hash several pieces as one stream.
+uint64_t hashKey(string_view key, uint64_t hash = 14695981039346656037ULL)
+{
+    for (unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian calendar date (month 1-12)
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+// Local calendar day of a point in time, as days since 1970-01-01
+int64_t localDay(time_t time)
+{
+    tm parts{};
+#ifdef _WIN32
+    localtime_s(&parts, &time);
+#else
+    localtime_r(&time, &parts);
+#endif
+    return daysFromCivil(parts.tm_year + 1900LL, parts.tm_mon + 1, parts.tm_mday);
+}
+
+// Local midnight at the start of a day number from localDay
+time_t dayStartTime(int64_t day)
+{
+    // Shift to days since 0000-03-01 so the year starts in March and leap days fall last
+    day += 719468;
+    int64_t era = (day >= 0 ? day : day - 146096) / 146097;
+    unsigned dayOfEra = static_cast<unsigned>(day - era * 146097);
+    unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+
+    tm parts{};
+    parts.tm_mday = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    parts.tm_mon = static_cast<int>(monthIndex < 10 ? monthIndex + 2 : monthIndex - 10);
+    parts.tm_year = static_cast<int>(yearOfEra + era * 400 + (parts.tm_mon <= 1) - 1900);
+    parts.tm_isdst = -1;
+    return mktime(&parts);
+}
+
+// Day number of a YYYY-MM-DD date; rejects malformed text and impossible dates
+bool parseDay(const string &text, int64_t &day)
+{
+    int year, month, dayOfMonth;
+    char extra;
+    if (sscanf(text.c_str(), "%d-%d-%d%c", &year, &month, &dayOfMonth, &extra) != 3 || month < 1 || month > 12 ||
+        dayOfMonth < 1 || dayOfMonth > 31)
+    {
+        return false;
+    }
+    day = daysFromCivil(year, month, dayOfMonth);
+    // Catches dates such as 2024-02-30 that would roll into the next month
+    return day < (month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, month + 1, 1));
+}
+
+// Read-only view of a whole data file. The file is memory-mapped where the platform
+// supports it, so loaders can tokenize it in place without copying lines out.
+class MappedFile
 {
 private:
-    string productID;
-    string name;
-    int quantity;
-    double price;
+    const char *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    string buffer;
+#endif
 
 public:
-    Product(string id, string name, int qty, double price) : productID(id), name(name), quantity(qty), price(price)
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
     {
+#ifndef _WIN32
+        if (data && size > 0)
+        {
+            munmap(const_cast<char *>(data), size);
+        }
+#endif
     }
 
-    string getProductID() const
+    bool open(const string &filename)
     {
-        return productID;
+#ifdef _WIN32
+        ifstream inFile(filename, ios::binary);
+        if (!inFile.is_open())
+        {
+            return false;
+        }
+        buffer.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+        return true;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat fileInfo;
+        if (fstat(fd, &fileInfo) != 0)
+        {
+            close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(fileInfo.st_size);
+        if (size > 0)
+        {
+            void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                close(fd);
+                size = 0;
+                return false;
+            }
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(mapping);
+        }
+        close(fd);
+        return true;
+#endif
     }
-    string getName() const
+
+    string_view contents() const
     {
-        return name;
+        return string_view(data, size);
     }
-    int getQuantity() const
+};
+
+// Calls f(line, lineNumber) for every non-empty line of text, without the line terminator
+template <typename F> void forEachLine(string_view text, F f)
+{
+    size_t lineNumber = 0;
+    while (!text.empty())
     {
-        return quantity;
+        size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        if (!line.empty())
+        {
+            f(line, lineNumber);
+        }
     }
-    double getPrice() const
+}
+
+// Splits off the text up to the next delimiter (or the whole rest) and advances past it
+string_view nextField(string_view &text, char delimiter)
+{
+    size_t pos = text.find(delimiter);
+    string_view field = text.substr(0, pos);
+    text.remove_prefix(pos == string_view::npos ? text.size() : pos + 1);
+    return field;
+}
+
+// Parses the whole field as a number; returns false on any malformed or trailing input
+template <typename T> bool parseNumber(string_view field, T &value)
+{
+    if (field.empty())
     {
-        return price;
+        return false;
     }
+    auto result = from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == errc() && result.ptr == field.data() + field.size();
+}
 
-    void updateQuantity(int qty)
+// Parses a decimal amount such as "12", "12.5" or "699.990000" into integer cents,
+// rounding any digits past the cents to the nearest cent
+bool parseCents(string_view field, int64_t &cents)
+{
+    bool negative = !field.empty() && field.front() == '-';
+    field.remove_prefix(negative ? 1 : 0);
+    size_t dot = field.find('.');
+    string_view whole = field.substr(0, dot);
+    string_view fraction = dot == string_view::npos ? string_view() : field.substr(dot + 1);
+    auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+    if ((whole.empty() && fraction.empty()) || whole.size() > 15 || !all_of(whole.begin(), whole.end(), isDigit) ||
+        !all_of(fraction.begin(), fraction.end(), isDigit))
     {
-        quantity = qty;
+        return false;
     }
-    void updatePrice(double newPrice)
+    int64_t value = 0;
+    for (char c : whole)
     {
-        price = newPrice;
+        value = value * 10 + (c - '0');
     }
-    void updateName(string newName)
+    for (size_t i = 0; i < 2; ++i)
     {
-        name = newName;
+        value = value * 10 + (i < fraction.size() ? fraction[i] - '0' : 0);
     }
-
-    void displayProduct() const
+    if (fraction.size() > 2 && fraction[2] >= '5')
     {
-        cout << "ID: " << productID << ", Name: " << name << ", Quantity: " << quantity << ", Price: $" << price
-             << endl;
+        value++;
     }
+    cents = negative ? -value : value;
+    return true;
+}
 
-    string toFileFormat() const
-    {
-        return productID + "," + name + "," + to_string(quantity) + "," + to_string(price);
-    }
+// Formats integer cents as a decimal amount with two places, e.g. "699.99"
+string formatCents(int64_t cents)
+{
+    unsigned long long magnitude = cents < 0 ? 0ULL - static_cast<unsigned long long>(cents) : cents;
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%s%llu.%02llu", cents < 0 ? "-" : "", magnitude / 100, magnitude % 100);
+    return buffer;
+}
 
-    static Product fromFileFormat(const string &line)
-    {
-        size_t pos = 0;
-        vector<string> tokens;
-        string modifiableLine = line;
+// Operations whose latency is recorded
+enum StatOperation
+{
+    STAT_PLACE_ORDER,
+    STAT_ADD_ORDER,
+    STAT_LOGIN,
+    STAT_LOAD_INVENTORY,
+    STAT_LOAD_ORDERS,
+    STAT_LOAD_SNAPSHOT,
+    STAT_JOURNAL_REPLAY,
+    STAT_JOURNAL_SYNC,
+    STAT_COMPACT,
+    STAT_SALES_REPORT,
+    STAT_OPERATION_COUNT
+};
 
-        while ((pos = modifiableLine.find(',')) != string::npos)
-        {
-            tokens.push_back(modifiableLine.substr(0, pos));
-            modifiableLine.erase(0, pos + 1);
-        }
-        tokens.push_back(modifiableLine);
-        return Product(tokens[0], tokens[1], stoi(tokens[2]), stod(tokens[3]));
-    }
+const char *const STAT_OPERATION_NAMES[STAT_OPERATION_COUNT] = {
+    "place_order",   "add_order",    "login",        "load_inventory", "load_orders",
+    "load_snapshot", "journal_replay", "journal_sync", "compact",      "sales_report"};
+
+// Events that are only counted
+enum StatCounter
+{
+    COUNTER_ORDERS_ACCEPTED,
+    COUNTER_ORDERS_REJECTED,
+    COUNTER_LOGIN_FAILURES,
+    COUNTER_PRODUCTS_CHANGED,
+    STAT_COUNTER_COUNT
 };
 
-// Order Class
-class Order
+const char *const STAT_COUNTER_NAMES[STAT_COUNTER_COUNT] = {"orders_accepted", "orders_rejected",
+                                                            "login_failures", "products_changed"};
+
+// Log-linear latency buckets over nanoseconds: each power of two is split into
+// 2^SUB_BITS equal buckets, so any recorded value is within 12.5% of its bucket bound
+struct LatencyBuckets
 {
-private:
-    string orderID;                     // Unique identifier for the order
-    vector<string> orderedProductNames; // List of product names in the order
-    vector<int> quantities;             // List of quantities for each product
-    time_t orderDate;                   // Date of the order
-    static int orderCounter;            // Counter for order IDs
+    static const int SUB_BITS = 3;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int COUNT = (64 - SUB_BITS + 1) * SUB_COUNT;
 
-public:
-    Order(string id, time_t date) : orderID(id), orderDate(date)
+    static int highestBit(uint64_t value)
     {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(value);
+#else
+        int bit = 0;
+        while (value >>= 1)
+        {
+            bit++;
+        }
+        return bit;
+#endif
     }
 
-    void addProduct(const string &productName, int quantity)
+    static int indexOf(uint64_t nanos)
     {
-        orderedProductNames.push_back(productName);
-        quantities.push_back(quantity);
+        if (nanos < SUB_COUNT)
+        {
+            return static_cast<int>(nanos);
+        }
+        int bit = highestBit(nanos);
+        return (bit - SUB_BITS + 1) * SUB_COUNT + static_cast<int>((nanos >> (bit - SUB_BITS)) & (SUB_COUNT - 1));
     }
 
-    vector<string> getOrderProductNames() const
-    {
-        return orderedProductNames;
-    }
-    void extractProductNamesFromOrders()
+    // Largest value that falls into the bucket
+    static uint64_t upperBound(int index)
     {
-        ifstream ordersFile("orders.txt");
-        if (!ordersFile.is_open())
+        if (index < SUB_COUNT)
         {
-            cerr << "Unable to open orders.txt for reading." << endl;
-            return;
+            return index;
         }
+        int shift = index / SUB_COUNT - 1;
+        uint64_t lower = uint64_t(SUB_COUNT + index % SUB_COUNT) << shift;
+        return lower + ((uint64_t(1) << shift) - 1);
+    }
+};
 
-        string line;
-        while (getline(ordersFile, line))
-        {
-            Order order = Order::fromFileFormat(line);
-            const auto &productNames = order.getOrderProductNames();
-            orderedProductNames.insert(orderedProductNames.end(), productNames.begin(), productNames.end());
-        }
+// Merged view of every thread's statistics
+struct StatsSnapshot
+{
+    uint64_t buckets[STAT_OPERATION_COUNT][LatencyBuckets::COUNT] = {};
+    uint64_t counts[STAT_OPERATION_COUNT] = {};
+    uint64_t totalNanos[STAT_OPERATION_COUNT] = {};
+    uint64_t maxNanos[STAT_OPERATION_COUNT] = {};
+    uint64_t counters[STAT_COUNTER_COUNT] = {};
 
-        ordersFile.close();
-    }
-    vector<int> getQuantities() const
-    {
-        return quantities;
-    }
-    string getOrderID() const
-    {
-        return orderID;
-    }
-    time_t getOrderDate() const
+    // Upper bound of the bucket holding the given fraction of samples
+    uint64_t percentile(StatOperation op, double fraction) const
     {
-        return orderDate;
+        uint64_t rank = uint64_t(ceil(fraction * counts[op]));
+        uint64_t seen = 0;
+        for (int i = 0; i < LatencyBuckets::COUNT; ++i)
+        {
+            seen += buckets[op][i];
+            if (seen >= max<uint64_t>(rank, 1))
+            {
+                return min(LatencyBuckets::upperBound(i), maxNanos[op]);
+            }
+        }
+        return 0;
     }
 
-    string toFileFormat() const
+    void printText(ostream &out) const
     {
-        string result = orderID + "," + to_string(orderDate);
-        for (size_t i = 0; i < orderedProductNames.size(); ++i)
+        out << left << setw(16) << "operation" << right << setw(10) << "count" << setw(12) << "mean_us"
+            << setw(12) << "p50_us" << setw(12) << "p90_us" << setw(12) << "p99_us" << setw(12) << "max_us"
+            << "\n";
+        out << fixed << setprecision(1);
+        for (int op = 0; op < STAT_OPERATION_COUNT; ++op)
         {
-            result += "|" + orderedProductNames[i] + "," + to_string(quantities[i]);
+            if (counts[op] == 0)
+            {
+                continue;
+            }
+            StatOperation operation = static_cast<StatOperation>(op);
+            out << left << setw(16) << STAT_OPERATION_NAMES[op] << right << setw(10) << counts[op] << setw(12)
+                << totalNanos[op] / 1e3 / counts[op] << setw(12) << percentile(operation, 0.50) / 1e3 << setw(12)
+                << percentile(operation, 0.90) / 1e3 << setw(12) << percentile(operation, 0.99) / 1e3
+                << setw(12) << maxNanos[op] / 1e3 << "\n";
         }
-        return result;
+        for (int counter = 0; counter < STAT_COUNTER_COUNT; ++counter)
+        {
+            out << left << setw(16) << STAT_COUNTER_NAMES[counter] << right << setw(10) << counters[counter]
+                << "\n";
+        }
+        out.flush();
     }
 
-    void displayOrder(const vector<Product> &inventory) const
+    void printJSON(ostream &out) const
     {
-        cout << "Order ID: " << orderID << "\n";
-        cout << "Order Date: " << ctime(&orderDate);
-        cout << "Products:\n";
-        for (size_t i = 0; i < orderedProductNames.size(); ++i)
+        out << fixed << setprecision(3) << "{\"operations\":{";
+        bool first = true;
+        for (int op = 0; op < STAT_OPERATION_COUNT; ++op)
         {
-            auto it = find_if(inventory.begin(), inventory.end(),
-                              [&](const Product &product)
-                              { return product.getName() == orderedProductNames[i]; });
-
-            if (it != inventory.end())
-            {
-                cout << "  - " << orderedProductNames[i] << " (Quantity: " << quantities[i] << ", Price: $"
-                     << it->getPrice() << ")\n";
-            }
-            else
-            {
-                cout << "  - " << orderedProductNames[i] << " (Quantity: " << quantities[i] << ", Price: N/A)\n";
-            }
+            StatOperation operation = static_cast<StatOperation>(op);
+            out << (first ? "" : ",") << "\"" << STAT_OPERATION_NAMES[op] << "\":{\"count\":" << counts[op]
+                << ",\"total_us\":" << totalNanos[op] / 1e3 << ",\"p50_us\":" << percentile(operation, 0.50) / 1e3
+                << ",\"p90_us\":" << percentile(operation, 0.90) / 1e3
+                << ",\"p99_us\":" << percentile(operation, 0.99) / 1e3 << ",\"max_us\":" << maxNanos[op] / 1e3
+                << "}";
+            first = false;
         }
+        out << "},\"counters\":{";
+        for (int counter = 0; counter < STAT_COUNTER_COUNT; ++counter)
+        {
+            out << (counter ? "," : "") << "\"" << STAT_COUNTER_NAMES[counter] << "\":" << counters[counter];
+        }
+        out << "}}" << endl;
     }
+};
 
-    static Order fromFileFormat(const string &line)
+// Process-wide operation statistics. Each thread records into its own block with plain
+// relaxed stores (no shared cache lines, no read-modify-write), and collect() sums the
+// blocks on demand. Blocks outlive their threads so no samples are lost.
+class Stats
+{
+private:
+    struct ThreadStats
     {
-        stringstream ss(line);
-        string orderID, productData;
-        string dateStr;
+        atomic<uint64_t> buckets[STAT_OPERATION_COUNT][LatencyBuckets::COUNT] = {};
+        atomic<uint64_t> totalNanos[STAT_OPERATION_COUNT] = {};
+        atomic<uint64_t> maxNanos[STAT_OPERATION_COUNT] = {};
+        atomic<uint64_t> counters[STAT_COUNTER_COUNT] = {};
+    };
 
-        // Extract order ID and order date
-        getline(ss, orderID, ','); // Order ID
-        getline(ss, dateStr, '|'); // Order date (separated by '|')
+    static mutex registryLock;
+    static vector<unique_ptr<ThreadStats>> registry;
 
-        time_t orderDate;
-        try
+    static ThreadStats &local()
+    {
+        static thread_local ThreadStats *stats = nullptr;
+        if (!stats)
         {
-            orderDate = static_cast<time_t>(stoll(dateStr)); // Convert date string to time_t
+            lock_guard<mutex> guard(registryLock);
+            registry.push_back(make_unique<ThreadStats>());
+            stats = registry.back().get();
         }
-        catch (const std::invalid_argument &e)
+        return *stats;
+    }
+
+    // Only the owning thread writes, so a load and a store are enough
+    static void bump(atomic<uint64_t> &value, uint64_t amount)
+    {
+        value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+
+public:
+    static void record(StatOperation op, uint64_t nanos)
+    {
+        ThreadStats &stats = local();
+        bump(stats.buckets[op][LatencyBuckets::indexOf(nanos)], 1);
+        bump(stats.totalNanos[op], nanos);
+        if (nanos > stats.maxNanos[op].load(memory_order_relaxed))
         {
-            cerr << "Invalid date format in order file: " << dateStr << endl;
-            orderDate = time(0); // Fallback to current time
+            stats.maxNanos[op].store(nanos, memory_order_relaxed);
         }
+    }
 
-        // Create an order instance
-        Order order(orderID, orderDate);
+    static void count(StatCounter counter, uint64_t amount = 1)
+    {
+        bump(local().counters[counter], amount);
+    }
 
-        // Extract products and quantities
-        while (getline(ss, productData, '|')) // Read product entries separated by '|'
+    static StatsSnapshot collect()
+    {
+        StatsSnapshot snapshot;
+        lock_guard<mutex> guard(registryLock);
+        for (const auto &stats : registry)
         {
-            size_t pos = productData.find(','); // Find the comma separating product name and quantity
-            if (pos != string::npos)
+            for (int op = 0; op < STAT_OPERATION_COUNT; ++op)
             {
-                string productName = productData.substr(0, pos);
-                int quantity = stoi(productData.substr(pos + 1)); // Parse quantity
-                order.addProduct(productName, quantity);
+                for (int i = 0; i < LatencyBuckets::COUNT; ++i)
+                {
+                    uint64_t samples = stats->buckets[op][i].load(memory_order_relaxed);
+                    snapshot.buckets[op][i] += samples;
+                    snapshot.counts[op] += samples;
+                }
+                snapshot.totalNanos[op] += stats->totalNanos[op].load(memory_order_relaxed);
+                snapshot.maxNanos[op] = max(snapshot.maxNanos[op], stats->maxNanos[op].load(memory_order_relaxed));
             }
-            else
+            for (int counter = 0; counter < STAT_COUNTER_COUNT; ++counter)
             {
-                cerr << "Invalid product data format: " << productData << endl;
+                snapshot.counters[counter] += stats->counters[counter].load(memory_order_relaxed);
             }
         }
-
-        return order;
+        return snapshot;
     }
 };
 
-int Order::orderCounter = 1;
+mutex Stats::registryLock;
+vector<unique_ptr<Stats::ThreadStats>> Stats::registry;
 
-// Warehouse Class
-class Warehouse
+// Records the time from construction to destruction under op
+class ScopedTimer
 {
 private:
-    vector<Product> inventory;
-    vector<Order> orders;
+    StatOperation op;
+    chrono::steady_clock::time_point start;
 
 public:
-    void addProduct(const Product &product)
+    explicit ScopedTimer(StatOperation op) : op(op), start(chrono::steady_clock::now())
     {
-        inventory.push_back(product);
     }
 
-    void addOrder()
+    ~ScopedTimer()
     {
-        // Generate a new order ID
-        string orderID = "O" + to_string(orders.size() + 1);
-
-        time_t now = time(0);
-        Order newOrder(orderID, now);
-        string productName;
-        int quantity;
-        char addMore;
-
-        cout << "Adding a new order: " << orderID << "\n";
-        cout << "Order Date and Time: " << ctime(&now);
+        Stats::record(op, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+};
 
-        do
-        {
-            cout << "Enter Product Name to add to order: ";
-            cin.ignore(); // Clear the buffer
-            getline(cin, productName);
-            cout << "Enter Quantity: ";
-            cin >> quantity;
+// A product's stock is one 64-bit word: a generation in the high half and the quantity in
+// the low half. A product's own stock keeps generation 0. Stock shared with other
+// processes lives in a slot whose generation changes when the slot is freed, so a product
+// still bound to it can no longer read or change the stock of whatever reuses the slot.
+uint64_t packStock(uint32_t generation, int quantity)
+{
+    return (uint64_t(generation) << 32) | uint32_t(quantity);
+}
 
-            // Find the product in the inventory by name
-            auto it = find_if(inventory.begin(), inventory.end(),
-                              [&](Product &product)
-                              { return product.getName() == productName; });
+uint32_t stockGeneration(uint64_t stock)
+{
+    return static_cast<uint32_t>(stock >> 32);
+}
 
-            if (it != inventory.end())
-            {
-                if (it->getQuantity() >= quantity)
-                {
-                    newOrder.addProduct(it->getName(), quantity); // Use product name
-                    it->updateQuantity(it->getQuantity() - quantity);
-                    cout << "Product \"" << productName << "\" found and added to the order successfully.\n";
-                }
-                else
-                {
-                    cout << "Insufficient quantity in inventory.\n";
-                }
-            }
-            else
-            {
-                cout << "Product \"" << productName << "\" not found in inventory.\n";
-            }
-            cout << "Add more products to the order? (y/n): ";
-            cin >> addMore;
+int stockQuantity(uint64_t stock)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(stock));
+}
 
-        } while (addMore == 'y' || addMore == 'Y');
+// Product Class
+class Product
+{
+private:
+    string productID;
+    string name;
+    alignas(64) atomic<uint64_t> ownStock; // On its own cache line so orders for other SKUs never contend
+    atomic<uint64_t> *stock = &ownStock;   // ownStock, or a slot shared with other processes
+    uint32_t generation = 0;               // Generation of the stock while it belongs to this product
+    int64_t price;                         // In cents; the last known price while bound to a slot
+    atomic<int64_t> *sharedPrice = nullptr; // The bound slot's price, which other processes may change
 
-        // Add the completed order to the order list
-        orders.push_back(newOrder);
+public:
+    Product(string id, string name, int qty, int64_t price)
+        : productID(id), name(name), ownStock(packStock(0, qty)), price(price)
+    {
+    }
+    // Prices are in cents; a price in dollars would otherwise convert silently
+    Product(string id, string name, int qty, double price) = delete;
+    // A copy of a product bound to a shared slot stays bound to it
+    Product(const Product &other)
+        : productID(other.productID), name(other.name), ownStock(packStock(0, other.getQuantity())),
+          stock(other.isShared() ? other.stock : &ownStock), generation(other.isShared() ? other.generation : 0),
+          price(other.price), sharedPrice(other.sharedPrice)
+    {
+    }
+    Product &operator=(const Product &other)
+    {
+        productID = other.productID;
+        name = other.name;
+        ownStock.store(packStock(0, other.getQuantity()));
+        stock = other.isShared() ? other.stock : &ownStock;
+        generation = other.isShared() ? other.generation : 0;
+        price = other.price;
+        sharedPrice = other.sharedPrice;
+        return *this;
+    }
 
-        // Generate the order details in the format O1,1731520409|ProductName,Quantity and save it to orders.txt
-        ofstream ordersFile("orders.txt", ios::app);
-        if (ordersFile.is_open())
+    const string &getProductID() const
+    {
+        return productID;
+    }
+    const string &getName() const
+    {
+        return name;
+    }
+    // 0 once the shared slot the product is bound to has been freed
+    int getQuantity() const
+    {
+        uint64_t current = stock->load(memory_order_acquire);
+        return stockGeneration(current) == generation ? stockQuantity(current) : 0;
+    }
+    // The bound slot's price, unless the slot was freed before or while it was read
+    int64_t getPrice() const
+    {
+        if (sharedPrice)
         {
-            stringstream orderDetails;
-
-            orderDetails << orderID << "," << newOrder.getOrderDate() << "|";
-
-            // Add product details in the format ProductName,Quantity (separated by commas)
-            const auto &productNames = newOrder.getOrderProductNames();
-            const auto &quantities = newOrder.getQuantities();
-            for (size_t i = 0; i < productNames.size(); ++i)
+            int64_t current = sharedPrice->load(memory_order_acquire);
+            if (stockGeneration(stock->load(memory_order_acquire)) == generation)
             {
-                orderDetails << productNames[i] << "," << quantities[i] << ",";
+                return current;
             }
+        }
+        return price;
+    }
 
-            string orderData = orderDetails.str();
-            orderData.pop_back(); // Remove the trailing comma
-            ordersFile << orderData << endl;
-            ordersFile.close();
+    // Keeps the stock and price in a shared slot from now on, for as long as the slot
+    // keeps its current generation, leaving their values as they are
+    void bindSlot(atomic<uint64_t> *sharedStock, atomic<int64_t> *slotPrice)
+    {
+        stock = sharedStock;
+        generation = stockGeneration(sharedStock->load(memory_order_acquire));
+        sharedPrice = slotPrice;
+        price = slotPrice->load(memory_order_acquire);
+    }
+    bool isShared() const
+    {
+        return stock != &ownStock;
+    }
 
-            // Display the structured invoice
-            cout << "\n===================== INVOICE =====================\n";
-            cout << "Order ID: " << orderID << "\n";
-            cout << "Date: " << ctime(&now);
-            cout << "---------------------------------------------------\n";
-            cout << "Product Name       Quantity     Price\n";
-            cout << "---------------------------------------------------\n";
+    // Returns the quantity it replaced, so the change can be journaled as a delta
+    int updateQuantity(int qty)
+    {
+        uint64_t current = stock->load(memory_order_acquire);
+        while (stockGeneration(current) == generation &&
+               !stock->compare_exchange_weak(current, packStock(generation, qty), memory_order_acq_rel,
+                                             memory_order_acquire))
+        {
+        }
+        return stockGeneration(current) == generation ? stockQuantity(current) : 0;
+    }
 
-            double totalCost = 0.0;
-            for (size_t i = 0; i < newOrder.getOrderProductNames().size(); ++i)
+    // Takes qty units with compare-and-swap if that many are in stock, so concurrent
+    // orders can never drive the stock below zero
+    bool reserve(int qty)
+    {
+        uint64_t current = stock->load(memory_order_acquire);
+        while (stockGeneration(current) == generation && stockQuantity(current) >= qty)
+        {
+            if (stock->compare_exchange_weak(current, packStock(generation, stockQuantity(current) - qty),
+                                             memory_order_acq_rel, memory_order_acquire))
             {
-                auto it = find_if(inventory.begin(), inventory.end(), [&](const Product &product)
-                                  { return product.getName() == newOrder.getOrderProductNames()[i]; });
-
-                if (it != inventory.end())
-                {
-                    double itemCost = it->getPrice() * newOrder.getQuantities()[i];
-                    totalCost += itemCost;
-                    cout << left << setw(18) << it->getName() << setw(12) << newOrder.getQuantities()[i] << fixed
-                         << setprecision(2) << itemCost << "\n";
-                }
+                return true;
             }
-
-            cout << "---------------------------------------------------\n";
-            cout << right << setw(44) << "Total Cost: " << fixed << setprecision(2) << totalCost << "\n";
-            cout << "===================================================\n";
         }
-        else
-        {
-            cout << "Unable to open orders.txt for writing.\n";
-        }
-
-        cout << "Order " << orderID << " added successfully!\n";
-        system("pause"); // Pause after generating the invoice
+        return false;
     }
 
-    void viewInventory() const
+    // Returns units taken by reserve
+    void release(int qty)
     {
-        cout << "Inventory:" << endl;
-        for (const auto &product : inventory)
+        uint64_t current = stock->load(memory_order_acquire);
+        while (stockGeneration(current) == generation &&
+               !stock->compare_exchange_weak(current, packStock(generation, stockQuantity(current) + qty),
+                                             memory_order_acq_rel, memory_order_acquire))
         {
-            product.displayProduct();
         }
-        system("pause"); // Pause after viewing inventory
     }
-
-    void viewOrders() const
+    void updatePrice(int64_t newPrice)
     {
-        cout << "Orders:" << endl;
-        for (const auto &order : orders)
+        price = newPrice;
+        if (sharedPrice && stockGeneration(stock->load(memory_order_acquire)) == generation)
         {
-            order.displayOrder(inventory);
+            sharedPrice->store(newPrice, memory_order_release);
         }
-        system("pause"); // Pause after viewing orders
+    }
+    void updateName(string newName)
+    {
+        name = newName;
     }
 
-    void searchProduct(const string &searchTerm)
+    void displayProduct() const
     {
-        cout << "Search Results for: " << searchTerm << endl;
-        bool found = false;
-        for (const auto &product : inventory)
-        {
-            if (product.getProductID() == searchTerm || product.getName() == searchTerm)
-            {
-                product.displayProduct();
-                found = true;
-            }
-        }
-        if (!found)
-        {
-            cout << "No products found matching: " << searchTerm << endl;
-        }
-        system("pause"); // Pause after search results
+        cout << "ID: " << productID << ", Name: " << name << ", Quantity: " << getQuantity() << ", Price: $"
+             << formatCents(getPrice()) << endl;
     }
 
-    void deleteProduct(const string &id)
+    string toFileFormat() const
+    {
+        return productID + "," + name + "," + to_string(getQuantity()) + "," + formatCents(getPrice());
+    }
+
+    // Parses "ID,Name,Quantity,Price"; on a malformed line returns nullopt and sets error
+    static optional<Product> fromFileFormat(string_view line, string &error)
     {
-        auto it = remove_if(inventory.begin(), inventory.end(),
-                            [&](const Product &product)
-                            { return product.getProductID() == id; });
-        if (it != inventory.end())
+        string_view id = nextField(line, ',');
+        string_view name = nextField(line, ',');
+        string_view qtyField = nextField(line, ',');
+        string_view priceField = nextField(line, ',');
+        int qty;
+        int64_t price;
+        if (id.empty() || name.empty())
         {
-            inventory.erase(it, inventory.end());
-            cout << "Product deleted successfully!" << endl;
+            error = "missing product ID or name";
+            return nullopt;
         }
-        else
+        if (!parseNumber(qtyField, qty) || !parseCents(priceField, price) || !line.empty())
         {
-            cout << "Product ID not found!" << endl;
+            error = "expected ID,Name,Quantity,Price";
+            return nullopt;
         }
-        system("pause"); // Pause after deleting a product
+        return Product(string(id), string(name), qty, price);
     }
+};
 
-    void updateProduct(const string &id)
+// Open-addressing (linear probing) index from a product key to its position in the inventory.
+// Only the key hash is stored; keys are compared through the keyAt callback so the
+// index never duplicates the product strings.
+class ProductIndex
+{
+private:
+    static const int EMPTY = -1;
+    static const int DELETED = -2;
+
+    struct Slot
     {
-        auto it =
-            find_if(inventory.begin(), inventory.end(), [&](Product &product)
-                    { return product.getProductID() == id; });
+        uint64_t hash;
+        int position;
+    };
 
-        if (it != inventory.end())
-        {
-            int choice;
-            cout << "1. Update Name\n";
-            cout << "2. Update Quantity\n";
-            cout << "3. Update Price\n";
-            cout << "Enter the attribute to update: ";
-            cin >> choice;
+    vector<Slot> slots;
+    size_t liveCount = 0; // Slots holding a position
+    size_t usedCount = 0; // Slots holding a position or a tombstone
 
-            switch (choice)
-            {
-            case 1:
+    void rehash(size_t newCapacity)
+    {
+        vector<Slot> oldSlots(newCapacity, Slot{0, EMPTY});
+        oldSlots.swap(slots);
+        usedCount = liveCount;
+        size_t mask = slots.size() - 1;
+        for (const auto &slot : oldSlots)
+        {
+            if (slot.position >= 0)
             {
-                string newName;
-                cout << "Enter new name: ";
-                cin >> newName;
-                it->updateName(newName);
-                cout << "Product name updated successfully.\n";
-                break;
+                size_t i = slot.hash & mask;
+                while (slots[i].position != EMPTY)
+                {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot;
             }
-            case 2:
+        }
+    }
+
+    template <typename KeyAt> size_t findSlot(string_view key, uint64_t hash, KeyAt keyAt) const
+    {
+        if (slots.empty())
+        {
+            return string::npos;
+        }
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots[i];
+            if (slot.position == EMPTY)
             {
-                int newQty;
-                cout << "Enter new quantity: ";
-                cin >> newQty;
-                it->updateQuantity(newQty);
-                cout << "Product quantity updated successfully.\n";
-                break;
+                return string::npos;
             }
-            case 3:
+            if (slot.position >= 0 && slot.hash == hash && keyAt(slot.position) == key)
             {
-                double newPrice;
-                cout << "Enter new price: ";
-                cin >> newPrice;
-                it->updatePrice(newPrice);
-                cout << "Product price updated successfully.\n";
-                break;
+                return i;
             }
-            default:
-                cout << "Invalid choice.\n";
-            }
-        }
-        else
-        {
-            cout << "Product ID not found!\n";
         }
-        system("pause"); // Pause after updating a product
     }
 
-    void saveInventoryToFile(const string &filename) const
+public:
+    template <typename KeyAt> int find(string_view key, KeyAt keyAt) const
     {
-        ofstream outFile(filename);
-        for (const auto &product : inventory)
-        {
-            outFile << product.toFileFormat() << endl;
-        }
-        outFile.close();
+        size_t i = findSlot(key, hashKey(key), keyAt);
+        return i == string::npos ? -1 : slots[i].position;
     }
 
-    void loadInventoryFromFile(const string &filename)
+    // Key must not already be present
+    void insert(string_view key, int position)
     {
-        ifstream inFile(filename);
-        string line;
-        while (getline(inFile, line))
+        // Keep the load factor (including tombstones) below 0.7
+        if ((usedCount + 1) * 10 > slots.size() * 7)
+        {
+            rehash(max<size_t>(16, liveCount * 10 >= slots.size() * 4 ? slots.size() * 2 : slots.size()));
+        }
+        uint64_t hash = hashKey(key);
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i].position >= 0)
         {
-            inventory.push_back(Product::fromFileFormat(line));
+            i = (i + 1) & mask;
         }
-        inFile.close();
+        if (slots[i].position == EMPTY)
+        {
+            usedCount++;
+        }
+        slots[i] = Slot{hash, position};
+        liveCount++;
     }
 
-    void saveOrdersToFile(const string &filename) const
+    template <typename KeyAt> void erase(string_view key, KeyAt keyAt)
     {
-        ofstream outFile(filename);
-        for (const auto &order : orders)
+        size_t i = findSlot(key, hashKey(key), keyAt);
+        if (i != string::npos)
         {
-            outFile << order.toFileFormat() << endl;
+            slots[i].position = DELETED;
+            liveCount--;
         }
-        outFile.close();
     }
 
-    void loadOrdersFromFile(const string &filename)
+    template <typename KeyAt> void move(string_view key, int newPosition, KeyAt keyAt)
     {
-        ifstream inFile(filename);
-        string line;
-        while (getline(inFile, line))
+        size_t i = findSlot(key, hashKey(key), keyAt);
+        if (i != string::npos)
         {
-            orders.push_back(Order::fromFileFormat(line));
+            slots[i].position = newPosition;
         }
-        inFile.close();
     }
 };
 
-class SalesReport
+// Inventory Class: the product list plus hash indexes by product ID and by name
+class Inventory
 {
-public:
-    virtual void generateSalesReport(const vector<Order> &orders) = 0; // Pure virtual function
+private:
+    vector<Product> products;
+    ProductIndex idIndex;
+    ProductIndex nameIndex;
 
-protected:
-    vector<Order> filterOrders(const vector<Order> &orders, time_t startTime, time_t endTime)
+    int findIDPosition(string_view id) const
     {
-        vector<Order> filteredOrders;
-        for (const auto &order : orders)
-        {
-            time_t orderDate = order.getOrderDate();
-            if (orderDate >= startTime && orderDate <= endTime)
-            {
-                filteredOrders.push_back(order);
-            }
-        }
-        return filteredOrders;
+        return idIndex.find(id, [&](int pos) -> const string & { return products[pos].getProductID(); });
+    }
+    int findNamePosition(string_view name) const
+    {
+        return nameIndex.find(name, [&](int pos) -> const string & { return products[pos].getName(); });
     }
 
-    unordered_map<string, int> aggregateSalesData(const vector<Order> &filteredOrders)
+public:
+    // Returns false if the product ID or name is already in use
+    bool add(const Product &product)
     {
-        unordered_map<string, int> salesData;
-        for (const auto &order : filteredOrders)
+        if (findIDPosition(product.getProductID()) >= 0 || findNamePosition(product.getName()) >= 0)
         {
-            const auto &productNames = order.getOrderProductNames();
-            const auto &quantities = order.getQuantities();
-            for (size_t i = 0; i < productNames.size(); ++i)
-            {
-                salesData[productNames[i]] += quantities[i];
-            }
+            return false;
         }
-        return salesData;
+        int pos = static_cast<int>(products.size());
+        products.push_back(product);
+        idIndex.insert(product.getProductID(), pos);
+        nameIndex.insert(product.getName(), pos);
+        return true;
+    }
+
+    Product *findByID(string_view id)
+    {
+        int pos = findIDPosition(id);
+        return pos >= 0 ? &products[pos] : nullptr;
+    }
+    const Product *findByID(string_view id) const
+    {
+        int pos = findIDPosition(id);
+        return pos >= 0 ? &products[pos] : nullptr;
+    }
+    Product *findByName(string_view name)
+    {
+        int pos = findNamePosition(name);
+        return pos >= 0 ? &products[pos] : nullptr;
+    }
+    const Product *findByName(string_view name) const
+    {
+        int pos = findNamePosition(name);
+        return pos >= 0 ? &products[pos] : nullptr;
     }
 
-    void printBarChart(const unordered_map<string, int> &salesData)
+    // Removes by swapping the last product into the freed position
+    bool remove(string_view id)
     {
-        int maxSales = 0;
-        for (const auto &data : salesData)
+        int pos = findIDPosition(id);
+        if (pos < 0)
         {
-            maxSales = max(maxSales, data.second);
+            return false;
         }
+        auto idAt = [&](int p) -> const string & { return products[p].getProductID(); };
+        auto nameAt = [&](int p) -> const string & { return products[p].getName(); };
+        idIndex.erase(products[pos].getProductID(), idAt);
+        nameIndex.erase(products[pos].getName(), nameAt);
 
-        cout << "\nSales Report Bar Chart:\n";
-        cout << "Product Name        | Sales Quantity\n";
-        cout << "-------------------------------------\n";
-
-        for (const auto &data : salesData)
+        int last = static_cast<int>(products.size()) - 1;
+        if (pos != last)
         {
-            cout << setw(20) << left << data.first << " | ";
-            int barLength = static_cast<int>((data.second / static_cast<double>(maxSales)) * 50);
-            for (int i = 0; i < barLength; ++i)
-            {
-                cout << "*";
-            }
-            cout << " " << data.second << endl;
+            idIndex.move(products[last].getProductID(), pos, idAt);
+            nameIndex.move(products[last].getName(), pos, nameAt);
+            products[pos] = products[last];
         }
+        products.pop_back();
+        return true;
     }
 
-    void printSalesSummary(const unordered_map<string, int> &salesData)
+    // Returns false if another product already uses the new name
+    bool rename(Product &product, const string &newName)
     {
-        cout << "\nSales Summary:\n";
-        cout << "Product Name        | Total Quantity Sold\n";
-        cout << "-----------------------------------------\n";
-        for (const auto &data : salesData)
+        if (product.getName() == newName)
         {
-            cout << setw(20) << left << data.first << " | " << data.second << endl;
+            return true;
         }
-    }
-
-    void printTopSellingProducts(const unordered_map<string, int> &salesData)
-    {
-        vector<pair<string, int>> sortedSalesData(salesData.begin(), salesData.end());
-        sort(sortedSalesData.begin(), sortedSalesData.end(), [](const pair<string, int> &a, const pair<string, int> &b)
-             { return b.second < a.second; });
-
-        cout << "\nTop Selling Products:\n";
-        cout << "Product Name        | Total Quantity Sold\n";
-        cout << "-----------------------------------------\n";
-        for (size_t i = 0; i < min(sortedSalesData.size(), size_t(5)); ++i)
+        if (findNamePosition(newName) >= 0)
         {
-            cout << setw(20) << left << sortedSalesData[i].first << " | " << sortedSalesData[i].second << endl;
+            return false;
         }
+        int pos = static_cast<int>(&product - products.data());
+        nameIndex.erase(product.getName(), [&](int p) -> const string & { return products[p].getName(); });
+        product.updateName(newName);
+        nameIndex.insert(newName, pos);
+        return true;
     }
 
-    void printAverageSales(size_t totalOrders)
+    const vector<Product> &getProducts() const
     {
-        cout << "\nAverage Sales:\n";
-        cout << "Total Orders: " << totalOrders << endl;
-        cout << "Average Orders per Day: " << (totalOrders / 7.0) << endl;
+        return products;
     }
 };
 
-class WeeklyReport : public SalesReport
+// Outcome of reserving stock for one order line
+enum ReserveResult
+{
+    RESERVED,
+    INSUFFICIENT_STOCK,
+    PRODUCT_NOT_FOUND
+};
+
+// Inventory partitioned into shards by the hash of the product name, the key every order
+// line carries. Each shard has its own indexes and lock, so order lines for different
+// shards never touch the same lock, and a product change only blocks its own shard.
+// A separate map from product ID to shard serves lookups by ID.
+//
+// add, remove, rename and updateByID must not run concurrently with each other; the
+// Warehouse serializes them under its commit lock.
+class ShardedInventory
 {
 public:
-    void generateSalesReport(const vector<Order> &orders) override
+    static const size_t DEFAULT_SHARD_COUNT = 64;
+
+    struct Shard
     {
-        time_t now = time(0);
-        tm lastWeek = *localtime(&now);
-        lastWeek.tm_mday -= 7;
-        mktime(&lastWeek);
+        Inventory inventory;
+        mutable shared_mutex lock;
+    };
 
-        vector<Order> filteredOrders = filterOrders(orders, mktime(&lastWeek), now);
-        if (filteredOrders.empty())
-        {
-            cout << "No orders found for the last week.\n";
-            return;
-        }
+private:
+    vector<unique_ptr<Shard>> shards;
+    // Product ID -> shard holding it. The keys view the map's own copies of the IDs, so
+    // a lookup on the order path builds no string.
+    unordered_map<string_view, pair<unique_ptr<const string>, uint32_t>> idShards;
+    mutable shared_mutex idLock;
 
-        unordered_map<string, int> salesData = aggregateSalesData(filteredOrders);
-        printBarChart(salesData);
-        printSalesSummary(salesData);
-        printTopSellingProducts(salesData);
-        printAverageSales(filteredOrders.size());
+    int findIDShard(string_view id) const
+    {
+        shared_lock<shared_mutex> guard(idLock);
+        auto it = idShards.find(id);
+        return it == idShards.end() ? -1 : static_cast<int>(it->second.second);
     }
-};
 
-class MonthlyReport : public SalesReport
-{
-public:
-    void generateSalesReport(const vector<Order> &orders) override
+    void setIDShard(string_view id, int shardIndex)
     {
-        time_t now = time(0);
-        tm lastMonth = *localtime(&now);
-        lastMonth.tm_mon -= 1;
-        mktime(&lastMonth);
-
-        vector<Order> filteredOrders = filterOrders(orders, mktime(&lastMonth), now);
-        if (filteredOrders.empty())
+        unique_lock<shared_mutex> guard(idLock);
+        auto it = idShards.find(id);
+        if (shardIndex < 0)
         {
-            cout << "No orders found for the last month.\n";
-            return;
+            if (it != idShards.end())
+            {
+                idShards.erase(it);
+            }
+        }
+        else if (it != idShards.end())
+        {
+            it->second.second = static_cast<uint32_t>(shardIndex);
+        }
+        else
+        {
+            auto ownedID = make_unique<const string>(id);
+            string_view key = *ownedID;
+            idShards.emplace(key, make_pair(move(ownedID), static_cast<uint32_t>(shardIndex)));
         }
-
-        unordered_map<string, int> salesData = aggregateSalesData(filteredOrders);
-        printBarChart(salesData);
-        printSalesSummary(salesData);
-        printTopSellingProducts(salesData);
-        printAverageSales(filteredOrders.size());
     }
-};
 
-class YearlyReport : public SalesReport
-{
 public:
-    void generateSalesReport(const vector<Order> &orders) override
+    explicit ShardedInventory(size_t shardCount = DEFAULT_SHARD_COUNT)
     {
-        time_t now = time(0);
-        tm lastYear = *localtime(&now);
-        lastYear.tm_year -= 1;
-        mktime(&lastYear);
-
-        vector<Order> filteredOrders = filterOrders(orders, mktime(&lastYear), now);
-        if (filteredOrders.empty())
+        for (size_t i = 0; i < max<size_t>(1, shardCount); ++i)
         {
-            cout << "No orders found for the last year.\n";
-            return;
+            shards.push_back(make_unique<Shard>());
         }
-
-        unordered_map<string, int> salesData = aggregateSalesData(filteredOrders);
-        printBarChart(salesData);
-        printSalesSummary(salesData);
-        printTopSellingProducts(salesData);
-        printAverageSales(filteredOrders.size());
     }
-};
-
-// Admin Registration
-bool registerAdmin()
-{
-    string username, password;
-    cout << "\tRegister Admin" << endl;
-    cout << "\tUsername: ";
-    cin.ignore();
-    getline(cin, username);
-    username = trim(username);
-    cout << "\tPassword: ";
-    getline(cin, password);
-    password = trim(password);
-
-    string hashedPassword = hashPassword(password);
 
-    ofstream outFile("admin_credentials.csv", ios::app);
-    if (!outFile.is_open())
+    size_t getShardCount() const
     {
-        cout << "\tError: Unable to open admin credentials file." << endl;
-        return false;
+        return shards.size();
     }
 
-    outFile << username << "," << hashedPassword << endl;
-    outFile.close();
-
-    cout << "\tAdmin registered successfully!" << endl;
-    system("pause"); // Pause after admin registration
-    return true;
-}
-
-// Admin Login
-bool loginAdmin()
-{
-    string username, password;
-    int failedAttempts = 0;
-    const int MAX_FAILED_ATTEMPTS = 3;
-    time_t lockTime = 0;
-    const int LOCK_TIME_MINUTES = 15;
-
-    cout << "\tLogin Admin" << endl;
-    cout << "\tUsername: ";
-    cin.ignore();
-    getline(cin, username);
-    username = trim(username);
-
-    cout << "\tPassword: ";
-    getline(cin, password);
-    password = trim(password);
-
-    string hashedPassword = hashPassword(password);
-
-    ifstream inFile("admin_credentials.csv");
-    if (!inFile.is_open())
+    size_t shardOf(string_view name) const
     {
-        cout << "\tError: Unable to open admin credentials file." << endl;
-        return false;
+        return hashKey(name) % shards.size();
     }
 
-    string line, storedUsername, storedPassword;
-    while (getline(inFile, line))
+    // Returns false if the product ID or name is already in use
+    bool add(const Product &product)
     {
-        stringstream ss(line);
-        getline(ss, storedUsername, ',');
-        getline(ss, storedPassword, ',');
-
-        if (storedUsername == username && storedPassword == hashedPassword)
+        if (findIDShard(product.getProductID()) >= 0)
         {
-            cout << "\tAdmin logged in successfully!" << endl;
-            inFile.close();
-            return true;
+            return false;
+        }
+        size_t shardIndex = shardOf(product.getName());
+        {
+            unique_lock<shared_mutex> guard(shards[shardIndex]->lock);
+            if (!shards[shardIndex]->inventory.add(product))
+            {
+                return false;
+            }
         }
+        setIDShard(product.getProductID(), static_cast<int>(shardIndex));
+        return true;
     }
-    inFile.close();
 
-    if (failedAttempts < MAX_FAILED_ATTEMPTS)
+    bool remove(string_view id)
     {
-        failedAttempts++;
-        cout << "\tInvalid username or password. You have " << MAX_FAILED_ATTEMPTS - failedAttempts << " attempts left."
-             << endl;
+        int shardIndex = findIDShard(id);
+        if (shardIndex < 0)
+        {
+            return false;
+        }
+        {
+            unique_lock<shared_mutex> guard(shards[shardIndex]->lock);
+            shards[shardIndex]->inventory.remove(id);
+        }
+        setIDShard(id, -1);
+        return true;
     }
-    else
+
+    // Renames a product, moving it to the shard its new name hashes to
+    bool rename(string_view id, const string &newName, string &error)
     {
-        time_t currentTime = time(0);
-        if (currentTime < lockTime)
+        int from = findIDShard(id);
+        if (from < 0)
         {
-            cout << "\tAccount locked. Please wait " << (LOCK_TIME_MINUTES - (difftime(currentTime, lockTime) / 60))
-                 << " minutes before trying again." << endl;
+            error = "Product ID not found!";
+            return false;
         }
-        else
+        int to = static_cast<int>(shardOf(newName));
+        if (from == to)
         {
-            lockTime = currentTime + (LOCK_TIME_MINUTES * 60);
-            cout << "\tAccount locked for " << LOCK_TIME_MINUTES << " minutes due to too many failed login attempts."
-                 << endl;
+            unique_lock<shared_mutex> guard(shards[from]->lock);
+            if (!shards[from]->inventory.rename(*shards[from]->inventory.findByID(id), newName))
+            {
+                error = "Another product already uses that name.";
+                return false;
+            }
+            return true;
         }
-    }
 
-    return false;
-}
+        // Lock both shards in index order
+        unique_lock<shared_mutex> first(shards[min(from, to)]->lock);
+        unique_lock<shared_mutex> second(shards[max(from, to)]->lock);
+        if (shards[to]->inventory.findByName(newName))
+        {
+            error = "Another product already uses that name.";
+            return false;
+        }
+        Product moved = *shards[from]->inventory.findByID(id);
+        moved.updateName(newName);
+        shards[from]->inventory.remove(id);
+        shards[to]->inventory.add(moved);
+        setIDShard(id, to);
+        return true;
+    }
 
-// Customer Registration
-bool registerCustomer()
-{
-    string username, password;
-    cout << "\tRegister Customer" << endl;
-    cout << "\tUsername: ";
-    cin.ignore();
-    getline(cin, username);
-    username = trim(username);
-
-    cout << "\tPassword: ";
-    getline(cin, password);
-    password = trim(password);
+    // Runs f(Product &) with its shard locked exclusively; false if the ID is unknown
+    template <typename F> bool updateByID(string_view id, F f)
+    {
+        int shardIndex = findIDShard(id);
+        if (shardIndex < 0)
+        {
+            return false;
+        }
+        unique_lock<shared_mutex> guard(shards[shardIndex]->lock);
+        f(*shards[shardIndex]->inventory.findByID(id));
+        return true;
+    }
 
-    string hashedPassword = hashPassword(password);
+    // Runs f(const Product &) with its shard locked for reading; false if not found
+    template <typename F> bool readByName(string_view name, F f) const
+    {
+        const Shard &shard = *shards[shardOf(name)];
+        shared_lock<shared_mutex> guard(shard.lock);
+        const Product *product = shard.inventory.findByName(name);
+        if (product)
+        {
+            f(*product);
+        }
+        return product != nullptr;
+    }
 
-    ofstream outFile("customer_credentials.csv", ios::app);
-    if (!outFile.is_open())
+    template <typename F> bool readByID(string_view id, F f) const
     {
-        cout << "\tError: Unable to open customer credentials file." << endl;
+        // A rename can move the product to another shard between the two lookups; retry once
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            int shardIndex = findIDShard(id);
+            if (shardIndex < 0)
+            {
+                return false;
+            }
+            shared_lock<shared_mutex> guard(shards[shardIndex]->lock);
+            const Product *product = shards[shardIndex]->inventory.findByID(id);
+            if (product)
+            {
+                f(*product);
+                return true;
+            }
+        }
         return false;
     }
 
-    outFile << username << "," << hashedPassword << endl;
-    outFile.close();
+    // Calls f(const Product &) for every product, one shard at a time
+    template <typename F> void forEachProduct(F f) const
+    {
+        for (const auto &shard : shards)
+        {
+            shared_lock<shared_mutex> guard(shard->lock);
+            for (const auto &product : shard->inventory.getProducts())
+            {
+                f(product);
+            }
+        }
+    }
 
-    cout << "\tCustomer registered successfully!" << endl;
-    system("pause"); // Pause after customer registration
-    return true;
-}
+    // Copies of every product ordered by ID, so saved files do not depend on the shard layout
+    vector<Product> getProducts() const
+    {
+        vector<Product> products;
+        forEachProduct([&](const Product &product) { products.push_back(product); });
+        sort(products.begin(), products.end(),
+             [](const Product &a, const Product &b) { return a.getProductID() < b.getProductID(); });
+        return products;
+    }
 
-// Customer Login
-bool loginCustomer()
-{
-    string username, password;
-    int failedAttempts = 0;
-    const int MAX_FAILED_ATTEMPTS = 3;
-    time_t lockTime = 0;
-    const int LOCK_TIME_MINUTES = 15;
+    // Takes qty units of the named product and sets productID to its ID, the key to
+    // release it by; only its shard is locked, and only for reading
+    ReserveResult reserve(string_view name, int qty, string &productID)
+    {
+        Shard &shard = *shards[shardOf(name)];
+        shared_lock<shared_mutex> guard(shard.lock);
+        Product *product = shard.inventory.findByName(name);
+        if (!product)
+        {
+            return PRODUCT_NOT_FOUND;
+        }
+        productID = product->getProductID();
+        return product->reserve(qty) ? RESERVED : INSUFFICIENT_STOCK;
+    }
 
-    cout << "\tLogin Customer" << endl;
-    cout << "\tUsername: ";
-    cin.ignore();
-    getline(cin, username);
-    username = trim(username);
+    // Returns units taken by reserve. The product is found by ID, so the units go back
+    // even if it was renamed in the meantime; a product since removed is ignored.
+    void release(string_view id, int qty)
+    {
+        // A rename can move the product to another shard between the two lookups; retry once
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            int shardIndex = findIDShard(id);
+            if (shardIndex < 0)
+            {
+                return;
+            }
+            shared_lock<shared_mutex> guard(shards[shardIndex]->lock);
+            Product *product = shards[shardIndex]->inventory.findByID(id);
+            if (product)
+            {
+                product->release(qty);
+                return;
+            }
+        }
+    }
+};
 
-    cout << "\tPassword: ";
-    getline(cin, password);
-    password = trim(password);
+// Thread pool where each worker owns a task deque: a worker pops its own newest task
+// first and, when it runs dry, steals the oldest task from another worker.
+class WorkStealingPool
+{
+private:
+    struct Worker
+    {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
 
-    string hashedPassword = hashPassword(password);
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+    // Submitting and taking tasks only touch the deques and these counters; stateLock is
+    // taken just to put a worker to sleep, to wake one that is asleep, and to wait for idle
+    atomic<size_t> queuedTasks{0};     // In the deques
+    atomic<size_t> unfinishedTasks{0}; // Submitted but not yet finished
+    atomic<size_t> sleepingWorkers{0};
+    mutex stateLock;
+    condition_variable workAvailable;
+    condition_variable allDone;
+    bool stopping = false;
 
-    ifstream inFile("customer_credentials.csv");
-    if (!inFile.is_open())
+    // The count is dropped under the deque's lock, so a queued task is always in a deque
+    bool takeFrom(Worker &worker, bool newest, function<void()> &task)
     {
-        cout << "\tError: Unable to open customer credentials file." << endl;
-        return false;
+        lock_guard<mutex> guard(worker.lock);
+        if (worker.tasks.empty())
+        {
+            return false;
+        }
+        if (newest)
+        {
+            task = move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        else
+        {
+            task = move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        queuedTasks.fetch_sub(1);
+        return true;
     }
 
-    string line, storedUsername, storedPassword;
-    while (getline(inFile, line))
+    bool popTask(size_t self, function<void()> &task)
     {
-        stringstream ss(line);
-        getline(ss, storedUsername, ',');
-        getline(ss, storedPassword, ',');
+        if (takeFrom(*workers[self], true, task))
+        {
+            return true;
+        }
+        for (size_t offset = 1; offset < workers.size(); ++offset)
+        {
+            if (takeFrom(*workers[(self + offset) % workers.size()], false, task))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
 
-        // Check if the account is locked
-        if (failedAttempts >= MAX_FAILED_ATTEMPTS)
+    void workerLoop(size_t self)
+    {
+        function<void()> task;
+        while (true)
         {
-            time_t currentTime = time(0);
-            if (currentTime < lockTime)
+            if (!popTask(self, task))
             {
-                cout << "\tAccount locked. Please wait " << (LOCK_TIME_MINUTES - (difftime(currentTime, lockTime) / 60))
-                     << " minutes before trying again." << endl;
-                inFile.close();
-                return false;
+                unique_lock<mutex> guard(stateLock);
+                sleepingWorkers.fetch_add(1);
+                workAvailable.wait(guard, [&] { return stopping || queuedTasks.load() > 0; });
+                sleepingWorkers.fetch_sub(1);
+                if (stopping && queuedTasks.load() == 0)
+                {
+                    return;
+                }
+                continue;
             }
-            else
+            task();
+            task = nullptr;
+            if (unfinishedTasks.fetch_sub(1) == 1)
             {
-                // Reset failed attempts after lock time
-                failedAttempts = 0;
+                lock_guard<mutex> guard(stateLock);
+                allDone.notify_all();
             }
         }
+    }
 
-        // Validate username and password
-        if (storedUsername == username && storedPassword == hashedPassword)
+public:
+    explicit WorkStealingPool(size_t threadCount)
+    {
+        threadCount = max<size_t>(1, threadCount);
+        for (size_t i = 0; i < threadCount; ++i)
         {
-            cout << "\tCustomer logged in successfully!" << endl;
-            inFile.close();
-            return true;
+            workers.push_back(make_unique<Worker>());
+        }
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
         }
     }
-    inFile.close();
 
-    failedAttempts++;
-    cout << "\tInvalid username or password. You have " << (MAX_FAILED_ATTEMPTS - failedAttempts) << " attempts left."
-         << endl;
+    ~WorkStealingPool()
+    {
+        waitIdle();
+        {
+            lock_guard<mutex> guard(stateLock);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto &worker : threads)
+        {
+            worker.join();
+        }
+    }
 
-    // Lock the account if max attempts are reached
-    if (failedAttempts >= MAX_FAILED_ATTEMPTS)
+    size_t size() const
     {
-        lockTime = time(0) + (LOCK_TIME_MINUTES * 60); // Set the lock time
-        cout << "\tAccount locked for " << LOCK_TIME_MINUTES << " minutes due to too many failed login attempts."
-             << endl;
+        return workers.size();
     }
 
-    return false;
-}
+    // Queues a task on the given worker's deque; idle workers steal it if that worker is busy
+    void submit(function<void()> task, size_t preferredWorker)
+    {
+        size_t target = preferredWorker % workers.size();
+        unfinishedTasks.fetch_add(1);
+        {
+            lock_guard<mutex> guard(workers[target]->lock);
+            workers[target]->tasks.push_back(move(task));
+            queuedTasks.fetch_add(1);
+        }
+        // A worker going to sleep counts itself before it checks queuedTasks, so either it
+        // sees this task or it is seen here and woken
+        if (sleepingWorkers.load() > 0)
+        {
+            lock_guard<mutex> guard(stateLock);
+            workAvailable.notify_one();
+        }
+    }
 
-// Main Menu Functions
-void displayHeader(const string &title)
-{
-    system("cls");
-    cout << "\n\t************************************************************\n";
-    cout << "\t*                                                          *\n";
-    cout << "\t*               " << title << "                *\n";
-    cout << "\t*                                                          *\n";
-    cout << "\t************************************************************\n\n";
-}
+    void waitIdle()
+    {
+        unique_lock<mutex> guard(stateLock);
+        allDone.wait(guard, [&] { return unfinishedTasks.load() == 0; });
+    }
+};
 
-void salesReportMenu()
+// Order Class
+class Order
 {
-    int choice;
-    do
+private:
+    string orderID;                     // Unique identifier for the order
+    vector<string> orderedProductNames; // List of product names in the order
+    vector<int> quantities;             // List of quantities for each product
+    vector<int64_t> unitPrices;         // Price in cents of each product when ordered
+    time_t orderDate;                   // Date of the order
+    static int orderCounter;            // Counter for order IDs
+
+public:
+    // Unit price of lines recorded by builds that did not capture prices
+    static constexpr int64_t UNKNOWN_PRICE = numeric_limits<int64_t>::min();
+
+    Order(string id, time_t date) : orderID(id), orderDate(date)
     {
-        displayHeader("Sales Report Menu");
-        cout << "1. Last Week\n";
-        cout << "2. Last Month\n";
-        cout << "3. Last Year\n";
-        cout << "4. Back to Admin Menu\n";
-        cout << "Enter your choice: ";
-        cin >> choice;
+    }
+
+    void addProduct(const string &productName, int quantity, int64_t unitPrice = UNKNOWN_PRICE)
+    {
+        orderedProductNames.push_back(productName);
+        quantities.push_back(quantity);
+        unitPrices.push_back(unitPrice);
+    }
 
-        vector<Order> orders;
+    const vector<string> &getOrderProductNames() const
+    {
+        return orderedProductNames;
+    }
+    void extractProductNamesFromOrders()
+    {
         ifstream ordersFile("orders.txt");
-        string line;
-        while (getline(ordersFile, line))
+        if (!ordersFile.is_open())
         {
-            orders.push_back(Order::fromFileFormat(line));
+            cerr << "Unable to open orders.txt for reading." << endl;
+            return;
         }
-        ordersFile.close();
 
-        WeeklyReport weeklyReport;
-        MonthlyReport monthlyReport;
-        YearlyReport yearlyReport;
+        string line, error;
+        while (getline(ordersFile, line))
+        {
+            optional<Order> order = Order::fromFileFormat(line, error);
+            if (order)
+            {
+                const auto &productNames = order->getOrderProductNames();
+                orderedProductNames.insert(orderedProductNames.end(), productNames.begin(), productNames.end());
+            }
+        }
 
-        switch (choice)
+        ordersFile.close();
+    }
+    const vector<int> &getQuantities() const
+    {
+        return quantities;
+    }
+    const vector<int64_t> &getUnitPrices() const
+    {
+        return unitPrices;
+    }
+    void setUnitPrice(size_t line, int64_t unitPrice)
+    {
+        unitPrices[line] = unitPrice;
+    }
+    // Quantity times unit price of every line whose price is known, in cents
+    int64_t getRevenue() const
+    {
+        int64_t revenue = 0;
+        for (size_t i = 0; i < quantities.size(); ++i)
         {
-        case 1:
-            weeklyReport.generateSalesReport(orders);
-            break;
-        case 2:
-            monthlyReport.generateSalesReport(orders);
-            break;
-        case 3:
-            yearlyReport.generateSalesReport(orders);
-            break;
-        case 4:
-            cout << "Returning to Admin Menu..." << endl;
-            break;
-        default:
-            cout << "Invalid choice. Please try again." << endl;
+            if (unitPrices[i] != UNKNOWN_PRICE)
+            {
+                revenue += quantities[i] * unitPrices[i];
+            }
         }
-        system("pause"); // Pause after sales report menu
-    } while (choice != 4);
-}
+        return revenue;
+    }
+    const string &getOrderID() const
+    {
+        return orderID;
+    }
+    time_t getOrderDate() const
+    {
+        return orderDate;
+    }
 
-// Admin menu
-void adminMenu(Warehouse &warehouse)
-{
-    int choice;
-    do
+    // Appends one "|Name,Quantity[,UnitPrice]" item of the file format to out
+    static void appendItem(string &out, string_view productName, int quantity, int64_t unitPrice)
     {
-        displayHeader("Admin Menu");
-        cout << "1. Add Product\n";
-        cout << "2. Update Product\n";
-        cout << "3. Remove Product\n";
-        cout << "4. View Inventory\n";
-        cout << "5. View Orders\n";
-        cout << "6. Generate Sales Report\n"; // New option for sales report
-        cout << "7. Logout\n";
-        cout << "Enter your choice: ";
-        cin >> choice;
+        out += '|';
+        out += productName;
+        out += ',';
+        out += to_string(quantity);
+        if (unitPrice != UNKNOWN_PRICE)
+        {
+            out += ',';
+            out += formatCents(unitPrice);
+        }
+    }
 
-        switch (choice)
+    string toFileFormat() const
+    {
+        string result = orderID + "," + to_string(orderDate);
+        for (size_t i = 0; i < orderedProductNames.size(); ++i)
         {
-        case 1:
+            appendItem(result, orderedProductNames[i], quantities[i], unitPrices[i]);
+        }
+        return result;
+    }
+
+    // Parses "OrderID,Date|Name,Quantity,UnitPrice|...". Lines written by older builds
+    // have no unit prices ("|Name,Quantity") or separate items with commas
+    // ("|Name,Quantity,Name,Quantity"); both are accepted. On a malformed line returns
+    // nullopt and sets error.
+    static optional<Order> fromFileFormat(string_view line, string &error)
+    {
+        Order order("", 0);
+        if (!parse(line, order, error))
         {
-            string id, name;
-            int qty;
-            double price;
-            cout << "Enter Product ID: ";
-            cin >> id;
-            cout << "Enter Name: ";
-            cin >> name;
-            cout << "Enter Quantity: ";
-            cin >> qty;
-            cout << "Enter Price: ";
-            cin >> price;
-            warehouse.addProduct(Product(id, name, qty, price));
-            cout << "Product added successfully!" << endl;
-            system("pause"); // Pause after adding a product
-            break;
+            return nullopt;
         }
-        case 2:
+        return order;
+    }
+
+    // Like fromFileFormat, but parses into an existing order and reuses its storage, so
+    // a loader parsing line after line into one Order stops allocating once it has seen
+    // its largest order. Returns false and sets error on a malformed line.
+    static bool parse(string_view line, Order &order, string &error)
+    {
+        string_view orderID = nextField(line, ',');
+        string_view dateField = nextField(line, '|');
+        long long date;
+        if (orderID.empty())
         {
-            string id;
-            cout << "Enter Product ID to Update: ";
-            cin >> id;
-            warehouse.updateProduct(id);
-            break;
+            error = "missing order ID";
+            return false;
         }
-        case 3:
+        if (!parseNumber(dateField, date))
         {
-            string id;
-            cout << "Enter Product ID to Remove: ";
-            cin >> id;
-            warehouse.deleteProduct(id);
-            system("pause"); // Pause after removing a product
-            break;
+            error = "invalid order date";
+            return false;
+        }
+
+        order.orderID.assign(orderID);
+        order.orderDate = static_cast<time_t>(date);
+        order.quantities.clear();
+        order.unitPrices.clear();
+        size_t lineCount = 0;
+        while (!line.empty())
+        {
+            string_view productData = nextField(line, '|');
+            // Name,Quantity pairs always have an even number of fields, so three means a price
+            bool hasPrice = count(productData.begin(), productData.end(), ',') == 2;
+            while (!productData.empty())
+            {
+                string_view productName = nextField(productData, ',');
+                string_view qtyField = nextField(productData, ',');
+                int quantity;
+                int64_t unitPrice = UNKNOWN_PRICE;
+                if (productName.empty() || !parseNumber(qtyField, quantity) ||
+                    (hasPrice && !parseCents(nextField(productData, ','), unitPrice)))
+                {
+                    error = "invalid product data";
+                    return false;
+                }
+                // Name strings are overwritten in place rather than freed and rebuilt
+                if (lineCount < order.orderedProductNames.size())
+                {
+                    order.orderedProductNames[lineCount].assign(productName);
+                }
+                else
+                {
+                    order.orderedProductNames.emplace_back(productName);
+                }
+                order.quantities.push_back(quantity);
+                order.unitPrices.push_back(unitPrice);
+                lineCount++;
+            }
+        }
+        order.orderedProductNames.resize(lineCount);
+        return true;
+    }
+};
+
+int Order::orderCounter = 1;
+
+// Append-only array whose elements never change once written. Growing copies the
+// elements into a new buffer and leaves the old one to whoever still shares it, so a
+// buffer and size taken under the writer's lock stay valid and unchanged after the lock
+// is released, however much is appended later.
+template <typename T> class SharedColumn
+{
+private:
+    shared_ptr<T[]> buffer;
+    size_t count = 0;
+    size_t capacity = 0;
+
+public:
+    void push_back(const T &value)
+    {
+        if (count == capacity)
+        {
+            capacity = max<size_t>(16, capacity * 2);
+            shared_ptr<T[]> grown(new T[capacity]);
+            copy(buffer.get(), buffer.get() + count, grown.get());
+            buffer = move(grown);
+        }
+        buffer[count++] = value;
+    }
+
+    const T &operator[](size_t i) const
+    {
+        return buffer[i];
+    }
+    const T *data() const
+    {
+        return buffer.get();
+    }
+    size_t size() const
+    {
+        return count;
+    }
+
+    // The current buffer; its first size() elements stay as they are for as long as it is held
+    shared_ptr<const T[]> share() const
+    {
+        return buffer;
+    }
+};
+
+// Interns product names as dense 32-bit ids for the analytics columns
+class ProductDictionary
+{
+private:
+    unordered_map<string, uint32_t> ids;
+    SharedColumn<string> names;
+
+public:
+    uint32_t intern(const string &name)
+    {
+        // try_emplace only builds a map node for a new name
+        auto result = ids.try_emplace(name, static_cast<uint32_t>(names.size()));
+        if (result.second)
+        {
+            names.push_back(name);
+        }
+        return result.first->second;
+    }
+
+    const string &nameOf(uint32_t id) const
+    {
+        return names[id];
+    }
+
+    size_t size() const
+    {
+        return names.size();
+    }
+
+    shared_ptr<const string[]> shareNames() const
+    {
+        return names.share();
+    }
+};
+
+// Quantity sold and revenue per interned product id, in cents
+struct SalesTotals
+{
+    vector<int64_t> units;
+    vector<int64_t> revenue;
+
+    void resize(size_t productCount)
+    {
+        units.resize(productCount, 0);
+        revenue.resize(productCount, 0);
+    }
+    size_t size() const
+    {
+        return units.size();
+    }
+};
+
+// Per-product quantity sold and revenue per local calendar day, stored as running (prefix)
+// sums over the days each product sold on. The total for any range of days is the
+// difference of two prefix sums, so a report costs O(products * log days) however many
+// orders it covers.
+class DailyRollup
+{
+private:
+    struct DayTotal
+    {
+        int64_t day;
+        int64_t units;   // Sum of this day and every earlier one
+        int64_t revenue; // Likewise, in cents
+    };
+
+    vector<vector<DayTotal>> productDays; // Indexed by interned product id, days ascending
+    vector<DayTotal> orderDays;           // Orders placed, counted in units
+
+    static void add(vector<DayTotal> &days, int64_t day, int64_t units, int64_t revenue)
+    {
+        // Orders normally arrive in date order, landing on the last day or a new one
+        if (days.empty() || days.back().day < day)
+        {
+            DayTotal last = days.empty() ? DayTotal{day, 0, 0} : days.back();
+            days.push_back({day, last.units + units, last.revenue + revenue});
+            return;
+        }
+        auto it = lower_bound(days.begin(), days.end(), day,
+                              [](const DayTotal &entry, int64_t value) { return entry.day < value; });
+        if (it->day != day)
+        {
+            DayTotal before = it == days.begin() ? DayTotal{day, 0, 0} : *prev(it);
+            it = days.insert(it, {day, before.units, before.revenue});
+        }
+        for (; it != days.end(); ++it)
+        {
+            it->units += units;
+            it->revenue += revenue;
+        }
+    }
+
+    // Sums of every day up to and including day
+    static DayTotal through(const vector<DayTotal> &days, int64_t day)
+    {
+        auto it = upper_bound(days.begin(), days.end(), day,
+                              [](int64_t value, const DayTotal &entry) { return value < entry.day; });
+        return it == days.begin() ? DayTotal{day, 0, 0} : *prev(it);
+    }
+
+public:
+    void addOrder(int64_t day, const uint32_t *products, const int32_t *quantities, const int64_t *revenue,
+                  size_t lineCount)
+    {
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            if (products[i] >= productDays.size())
+            {
+                productDays.resize(products[i] + 1);
+            }
+            add(productDays[products[i]], day, quantities[i], revenue[i]);
+        }
+        add(orderDays, day, 1, 0);
+    }
+
+    // Quantity sold and revenue per product id over days [fromDay, toDay]
+    SalesTotals totals(int64_t fromDay, int64_t toDay) const
+    {
+        SalesTotals result;
+        result.resize(productDays.size());
+        if (fromDay > toDay)
+        {
+            return result;
+        }
+        for (size_t id = 0; id < productDays.size(); ++id)
+        {
+            DayTotal last = through(productDays[id], toDay);
+            DayTotal beforeFirst = through(productDays[id], fromDay - 1);
+            result.units[id] = last.units - beforeFirst.units;
+            result.revenue[id] = last.revenue - beforeFirst.revenue;
+        }
+        return result;
+    }
+
+    size_t countOrders(int64_t fromDay, int64_t toDay) const
+    {
+        return fromDay > toDay ? 0
+                               : static_cast<size_t>(through(orderDays, toDay).units -
+                                                     through(orderDays, fromDay - 1).units);
+    }
+};
+
+// Read-only view of one order in an OrderHistory snapshot. The line arrays point into the
+// history's columns and names resolve through its dictionary, so reading, printing or
+// saving an order copies none of it. Valid for as long as the snapshot is held.
+class OrderView
+{
+private:
+    const string *productNames; // Indexed by interned product id
+    string_view orderID;
+    time_t orderDate;
+    const uint32_t *products;
+    const int32_t *quantities;
+    const int64_t *unitPrices;
+    size_t lineCount;
+
+public:
+    OrderView(const string *productNames, string_view orderID, time_t orderDate, const uint32_t *products,
+              const int32_t *quantities, const int64_t *unitPrices, size_t lineCount)
+        : productNames(productNames), orderID(orderID), orderDate(orderDate), products(products),
+          quantities(quantities), unitPrices(unitPrices), lineCount(lineCount)
+    {
+    }
+
+    string_view getOrderID() const
+    {
+        return orderID;
+    }
+    time_t getOrderDate() const
+    {
+        return orderDate;
+    }
+    size_t getLineCount() const
+    {
+        return lineCount;
+    }
+    // Per-line arrays of getLineCount() elements
+    const uint32_t *getProductIds() const
+    {
+        return products;
+    }
+    const int32_t *getQuantities() const
+    {
+        return quantities;
+    }
+    const int64_t *getUnitPrices() const
+    {
+        return unitPrices;
+    }
+    const string &getProductName(size_t line) const
+    {
+        return productNames[products[line]];
+    }
+
+    // Total of the lines with a known unit price, in cents
+    int64_t getRevenue() const
+    {
+        int64_t revenue = 0;
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            if (unitPrices[i] != Order::UNKNOWN_PRICE)
+            {
+                revenue += quantities[i] * unitPrices[i];
+            }
+        }
+        return revenue;
+    }
+
+    // Appends the order in Order::toFileFormat's format, without the newline
+    void appendFileFormat(string &out) const
+    {
+        out += orderID;
+        out += ',';
+        out += to_string(orderDate);
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            Order::appendItem(out, getProductName(i), quantities[i], unitPrices[i]);
+        }
+    }
+
+    void displayOrder() const
+    {
+        cout << "Order ID: " << orderID << "\n";
+        cout << "Order Date: " << ctime(&orderDate);
+        cout << "Products:\n";
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            cout << "  - " << getProductName(i) << " (Quantity: " << quantities[i] << ", Price: ";
+            if (unitPrices[i] != Order::UNKNOWN_PRICE)
+            {
+                cout << "$" << formatCents(unitPrices[i]);
+            }
+            else
+            {
+                cout << "N/A";
+            }
+            cout << ")\n";
+        }
+    }
+};
+
+// Every recorded order in recording order, laid out for histories of millions of orders.
+// Order IDs and the index over them are packed into a monotonic arena, line items share
+// flat columns with product names interned once in the dictionary, so an order costs a
+// few dozen bytes and, once the buffers have grown, no heap allocations of its own. Orders are only ever appended, and
+// readers work on snapshots, so one writer and any number of readers never contend.
+class OrderHistory
+{
+private:
+    struct Entry
+    {
+        string_view orderID; // Characters live in idArena
+        int64_t orderDate;
+        size_t firstLine;
+    };
+
+    pmr::monotonic_buffer_resource idArena;
+    pmr::unordered_set<string_view> orderIDs{&idArena}; // Views into idArena, nodes allocated there too
+    ProductDictionary dictionary;
+    SharedColumn<Entry> entries;
+    SharedColumn<uint32_t> lineProducts;  // Interned product id of each line
+    SharedColumn<int32_t> lineQuantities; // Quantity of each line
+    SharedColumn<int64_t> lineUnitPrices; // Unit price of each line in cents, or Order::UNKNOWN_PRICE
+
+public:
+    // The history as it stood when the snapshot was taken. It shares the history's
+    // buffers rather than copying them, and nothing in the shared part ever changes, so
+    // it can be read without locks while orders are added. A buffer the history has
+    // outgrown is freed when the last snapshot holding it is released.
+    class Snapshot
+    {
+    private:
+        friend class OrderHistory;
+        shared_ptr<const Entry[]> entries;
+        shared_ptr<const uint32_t[]> lineProducts;
+        shared_ptr<const int32_t[]> lineQuantities;
+        shared_ptr<const int64_t[]> lineUnitPrices;
+        shared_ptr<const string[]> productNames;
+        size_t orderCount = 0;
+        size_t lineCount = 0;
+        size_t productCount = 0;
+
+    public:
+        size_t size() const
+        {
+            return orderCount;
+        }
+        size_t getLineCount() const
+        {
+            return lineCount;
+        }
+        // Number of interned product names
+        size_t getProductCount() const
+        {
+            return productCount;
+        }
+        const string &nameOf(uint32_t productId) const
+        {
+            return productNames[productId];
+        }
+
+        OrderView view(size_t index) const
+        {
+            size_t firstLine = entries[index].firstLine;
+            size_t endLine = index + 1 < orderCount ? entries[index + 1].firstLine : lineCount;
+            return OrderView(productNames.get(), entries[index].orderID,
+                             static_cast<time_t>(entries[index].orderDate), lineProducts.get() + firstLine,
+                             lineQuantities.get() + firstLine, lineUnitPrices.get() + firstLine,
+                             endLine - firstLine);
+        }
+    };
+
+    OrderHistory() = default;
+    OrderHistory(const OrderHistory &) = delete;
+    OrderHistory &operator=(const OrderHistory &) = delete;
+
+    // Appends the order; its ID must not be in the history yet
+    void add(const Order &order)
+    {
+        const string &orderID = order.getOrderID();
+        char *idCopy = static_cast<char *>(idArena.allocate(max<size_t>(1, orderID.size()), 1));
+        memcpy(idCopy, orderID.data(), orderID.size());
+        entries.push_back({string_view(idCopy, orderID.size()), int64_t(order.getOrderDate()), lineProducts.size()});
+        orderIDs.insert(entries[entries.size() - 1].orderID);
+
+        const auto &productNames = order.getOrderProductNames();
+        const auto &quantities = order.getQuantities();
+        const auto &unitPrices = order.getUnitPrices();
+        for (size_t i = 0; i < productNames.size(); ++i)
+        {
+            lineProducts.push_back(dictionary.intern(productNames[i]));
+            lineQuantities.push_back(quantities[i]);
+            lineUnitPrices.push_back(unitPrices[i]);
+        }
+    }
+
+    bool contains(string_view orderID) const
+    {
+        return orderIDs.count(orderID) > 0;
+    }
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    // Call under the same lock as add, or when no order can be added
+    Snapshot snapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.entries = entries.share();
+        snapshot.lineProducts = lineProducts.share();
+        snapshot.lineQuantities = lineQuantities.share();
+        snapshot.lineUnitPrices = lineUnitPrices.share();
+        snapshot.productNames = dictionary.shareNames();
+        snapshot.orderCount = entries.size();
+        snapshot.lineCount = lineProducts.size();
+        snapshot.productCount = dictionary.size();
+        return snapshot;
+    }
+};
+
+// Columnar store of order lines for sales analytics. Each order line is one row across
+// the time, product, quantity and revenue columns, so aggregation is a scan over integer
+// arrays. Orders are kept sorted by order date, so a date window is located with two
+// binary searches and maps to one contiguous range of lines. A DailyRollup of the same
+// lines answers whole-day ranges without scanning them.
+class OrderLineStore
+{
+private:
+    size_t productCount = 0;            // One past the highest product id seen
+    vector<int64_t> lineTimes;          // Order date of each line
+    vector<uint32_t> lineProducts;      // Interned product id of each line
+    vector<int32_t> lineQuantities;     // Quantity of each line
+    vector<int64_t> lineRevenue;        // Quantity times unit price of each line, in cents
+    vector<int64_t> orderTimes;         // Order date of each order, ascending
+    vector<size_t> orderLineOffsets{0}; // First line of each order, plus the end of the last one
+    size_t reorderCount = 0;            // Number of orders inserted before existing ones
+    DailyRollup rollup;                 // The same lines summed per calendar day
+
+    static const size_t MIN_LINES_PER_CHUNK = 1 << 16;
+
+public:
+    // Threads aggregate may use; 0 means one per hardware thread
+    static size_t aggregationThreads;
+
+    void addOrder(const OrderView &order)
+    {
+        int64_t orderDate = order.getOrderDate();
+        size_t lineCount = order.getLineCount();
+        const uint32_t *products = order.getProductIds();
+        const int32_t *quantities = order.getQuantities();
+        const int64_t *unitPrices = order.getUnitPrices();
+
+        // Orders normally arrive in date order; an older one is inserted at its sorted position
+        size_t orderPos = upper_bound(orderTimes.begin(), orderTimes.end(), orderDate) - orderTimes.begin();
+        size_t linePos = orderLineOffsets[orderPos];
+        lineTimes.insert(lineTimes.begin() + linePos, lineCount, orderDate);
+        lineProducts.insert(lineProducts.begin() + linePos, lineCount, 0);
+        lineQuantities.insert(lineQuantities.begin() + linePos, lineCount, 0);
+        lineRevenue.insert(lineRevenue.begin() + linePos, lineCount, 0);
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            productCount = max<size_t>(productCount, products[i] + 1);
+            lineProducts[linePos + i] = products[i];
+            lineQuantities[linePos + i] = quantities[i];
+            if (unitPrices[i] != Order::UNKNOWN_PRICE)
+            {
+                lineRevenue[linePos + i] = quantities[i] * unitPrices[i];
+            }
+        }
+        rollup.addOrder(localDay(orderDate), lineProducts.data() + linePos, lineQuantities.data() + linePos,
+                        lineRevenue.data() + linePos, lineCount);
+
+        if (orderPos != orderTimes.size())
+        {
+            reorderCount++;
+        }
+        orderTimes.insert(orderTimes.begin() + orderPos, orderDate);
+        orderLineOffsets.insert(orderLineOffsets.begin() + orderPos + 1, linePos + lineCount);
+        for (size_t i = orderPos + 2; i < orderLineOffsets.size(); ++i)
+        {
+            orderLineOffsets[i] += lineCount;
+        }
+    }
+
+    // Half-open range of order positions dated within [startTime, endTime]
+    pair<size_t, size_t> orderRange(time_t startTime, time_t endTime) const
+    {
+        size_t first = lower_bound(orderTimes.begin(), orderTimes.end(), int64_t(startTime)) - orderTimes.begin();
+        size_t last = upper_bound(orderTimes.begin() + first, orderTimes.end(), int64_t(endTime)) - orderTimes.begin();
+        return {first, last};
+    }
+
+    // Sums the quantity sold and revenue per product id over orders dated within
+    // [startTime, endTime]. Large ranges are split into chunks summed by separate threads
+    // into their own tables, which are then merged; integer sums make the result exact and
+    // independent of the split.
+    SalesTotals aggregate(time_t startTime, time_t endTime) const
+    {
+        pair<size_t, size_t> range = orderRange(startTime, endTime);
+        size_t lineBegin = orderLineOffsets[range.first];
+        size_t lineCount = orderLineOffsets[range.second] - lineBegin;
+
+        // Each chunk needs enough lines to pay for its thread and its own table
+        size_t threads = aggregationThreads ? aggregationThreads : max(1u, thread::hardware_concurrency());
+        size_t chunks = min({threads, lineCount / MIN_LINES_PER_CHUNK, lineCount / max<size_t>(1, productCount)});
+        chunks = max<size_t>(1, chunks);
+
+        vector<SalesTotals> partials(chunks);
+        auto runParallel = [&](auto task)
+        {
+            vector<thread> workers;
+            for (size_t chunk = 1; chunk < chunks; ++chunk)
+            {
+                workers.emplace_back(task, chunk);
+            }
+            task(0);
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        };
+
+        runParallel(
+            [&](size_t chunk)
+            {
+                SalesTotals &totals = partials[chunk];
+                totals.resize(productCount);
+                int64_t *units = totals.units.data();
+                int64_t *revenue = totals.revenue.data();
+                const uint32_t *products = lineProducts.data();
+                const int32_t *quantities = lineQuantities.data();
+                const int64_t *lineRevenues = lineRevenue.data();
+                size_t end = lineBegin + lineCount * (chunk + 1) / chunks;
+                for (size_t i = lineBegin + lineCount * chunk / chunks; i < end; ++i)
+                {
+                    units[products[i]] += quantities[i];
+                    revenue[products[i]] += lineRevenues[i];
+                }
+            });
+        if (chunks > 1)
+        {
+            // Merge in parallel too, each thread owning a slice of the product ids
+            runParallel(
+                [&](size_t chunk)
+                {
+                    size_t end = productCount * (chunk + 1) / chunks;
+                    for (size_t id = productCount * chunk / chunks; id < end; ++id)
+                    {
+                        for (size_t other = 1; other < chunks; ++other)
+                        {
+                            partials[0].units[id] += partials[other].units[id];
+                            partials[0].revenue[id] += partials[other].revenue[id];
+                        }
+                    }
+                });
+        }
+        return move(partials[0]);
+    }
+
+    size_t countOrders(time_t startTime, time_t endTime) const
+    {
+        pair<size_t, size_t> range = orderRange(startTime, endTime);
+        return range.second - range.first;
+    }
+
+    size_t getOrderCount() const
+    {
+        return orderTimes.size();
+    }
+    int64_t getOrderTime(size_t orderPos) const
+    {
+        return orderTimes[orderPos];
+    }
+    // Positions of existing orders shift whenever this changes
+    size_t getReorderCount() const
+    {
+        return reorderCount;
+    }
+
+    // Adds sign * quantity and sign * revenue of every line of the order at orderPos into totals
+    void accumulateOrder(size_t orderPos, int sign, SalesTotals &totals) const
+    {
+        if (totals.size() < productCount)
+        {
+            totals.resize(productCount);
+        }
+        for (size_t i = orderLineOffsets[orderPos]; i < orderLineOffsets[orderPos + 1]; ++i)
+        {
+            totals.units[lineProducts[i]] += sign * lineQuantities[i];
+            totals.revenue[lineProducts[i]] += sign * lineRevenue[i];
+        }
+    }
+
+    const DailyRollup &getRollup() const
+    {
+        return rollup;
+    }
+};
+
+size_t OrderLineStore::aggregationThreads = 0;
+
+// Running per-product totals over a window [startTime, now]. Orders are added as they are
+// recorded and subtracted once they fall out of the window, so reading the window costs
+// only the orders that expired since the last read.
+class SalesWindow
+{
+private:
+    SalesTotals totals;        // Quantity sold and revenue per interned product id
+    size_t firstOrder = 0;     // Orders [firstOrder, lastOrder) of the store are counted
+    size_t lastOrder = 0;
+    int64_t startTime = 0;
+    size_t reorderCount = 0;   // Store reorder count the positions above refer to
+
+    void rebuild(const OrderLineStore &store, int64_t newStartTime)
+    {
+        startTime = newStartTime;
+        totals = store.aggregate(startTime, numeric_limits<time_t>::max());
+        firstOrder = store.orderRange(startTime, numeric_limits<time_t>::max()).first;
+        lastOrder = store.getOrderCount();
+        reorderCount = store.getReorderCount();
+    }
+
+public:
+    // Counts orders recorded in the store since the last call
+    void catchUp(const OrderLineStore &store)
+    {
+        if (reorderCount != store.getReorderCount())
+        {
+            rebuild(store, startTime);
+            return;
+        }
+        for (; lastOrder < store.getOrderCount(); ++lastOrder)
+        {
+            store.accumulateOrder(lastOrder, 1, totals);
+        }
+    }
+
+    // Moves the start of the window to newStartTime, dropping orders that fell out of it
+    void expire(const OrderLineStore &store, int64_t newStartTime)
+    {
+        if (newStartTime < startTime || reorderCount != store.getReorderCount())
+        {
+            rebuild(store, newStartTime);
+            return;
+        }
+
+        // Summing what stays (in parallel) is cheaper than subtracting what leaves when
+        // most of the window expires, as on the first report after loading the history
+        size_t newFirstOrder = store.orderRange(newStartTime, numeric_limits<time_t>::max()).first;
+        if (newFirstOrder > firstOrder && newFirstOrder - firstOrder > lastOrder - newFirstOrder)
+        {
+            rebuild(store, newStartTime);
+            return;
+        }
+        startTime = newStartTime;
+        for (; firstOrder < lastOrder && store.getOrderTime(firstOrder) < startTime; ++firstOrder)
+        {
+            store.accumulateOrder(firstOrder, -1, totals);
+        }
+    }
+
+    const SalesTotals &getTotals() const
+    {
+        return totals;
+    }
+    size_t getOrderCount() const
+    {
+        return lastOrder - firstOrder;
+    }
+};
+
+// The k best elements of items, best first, in O(n log k). A bounded heap holds the k
+// best seen so far with the worst of them on top, so the input is never fully sorted.
+template <typename T, typename Better> vector<T> selectTopK(const vector<T> &items, size_t k, Better better)
+{
+    vector<T> heap;
+    heap.reserve(min(k, items.size()));
+    for (const auto &item : items)
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back(item);
+            push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (k > 0 && better(item, heap.front()))
+        {
+            pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = item;
+            push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    sort_heap(heap.begin(), heap.end(), better);
+    return heap;
+}
+
+// Space-saving heavy-hitters sketch: tracks at most capacity items in bounded memory. An
+// untracked item takes over the slot of the smallest count and inherits that count as
+// its error, so a tracked count overestimates the true total by at most its error, and
+// every item whose true total exceeds (total weight / capacity) is tracked.
+class SpaceSavingSketch
+{
+public:
+    struct Entry
+    {
+        string item;
+        int64_t count;
+        int64_t error;
+    };
+
+private:
+    size_t capacity;
+    vector<Entry> heap; // Min-heap on count
+    unordered_map<string, size_t> positions;
+
+    void swapEntries(size_t a, size_t b)
+    {
+        swap(heap[a], heap[b]);
+        positions[heap[a].item] = a;
+        positions[heap[b].item] = b;
+    }
+
+    // Restores the heap after the count at pos grew
+    void siftDown(size_t pos)
+    {
+        while (true)
+        {
+            size_t smallest = pos;
+            for (size_t child = 2 * pos + 1; child <= 2 * pos + 2 && child < heap.size(); ++child)
+            {
+                if (heap[child].count < heap[smallest].count)
+                {
+                    smallest = child;
+                }
+            }
+            if (smallest == pos)
+            {
+                return;
+            }
+            swapEntries(pos, smallest);
+            pos = smallest;
+        }
+    }
+
+    void siftUp(size_t pos)
+    {
+        while (pos > 0 && heap[pos].count < heap[(pos - 1) / 2].count)
+        {
+            swapEntries(pos, (pos - 1) / 2);
+            pos = (pos - 1) / 2;
+        }
+    }
+
+public:
+    explicit SpaceSavingSketch(size_t capacity = 0) : capacity(capacity)
+    {
+    }
+
+    size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+    void add(const string &item, int64_t weight)
+    {
+        if (capacity == 0 || weight <= 0)
+        {
+            return;
+        }
+        auto it = positions.find(item);
+        if (it != positions.end())
+        {
+            heap[it->second].count += weight;
+            siftDown(it->second);
+        }
+        else if (heap.size() < capacity)
+        {
+            heap.push_back(Entry{item, weight, 0});
+            positions[item] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+        }
+        else
+        {
+            // Evict the smallest counter; the newcomer may have been counted that often
+            positions.erase(heap[0].item);
+            heap[0] = Entry{item, heap[0].count + weight, heap[0].count};
+            positions[item] = 0;
+            siftDown(0);
+        }
+    }
+
+    // The k largest tracked counts, largest first
+    vector<Entry> top(size_t k) const
+    {
+        return selectTopK(heap, k,
+                          [](const Entry &a, const Entry &b)
+                          { return a.count != b.count ? a.count > b.count : a.item < b.item; });
+    }
+};
+
+// Spreads the bits of a hashKey result so every bit range is usable on its own
+uint64_t mixHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb33fa5c4e10bULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Count-min sketch of per-key totals in fixed memory. An estimate never undercounts,
+// and with probability 1 - e^-DEPTH (about 98%) overcounts by at most e / WIDTH of the
+// total weight added.
+class CountMinSketch
+{
+public:
+    static const size_t WIDTH = 1024;
+    static const size_t DEPTH = 4;
+
+private:
+    vector<uint32_t> counters = vector<uint32_t>(WIDTH * DEPTH, 0);
+    uint64_t total = 0;
+
+    // Each row rehashes with its own seed so rows collide independently
+    static size_t column(uint64_t hash, size_t row)
+    {
+        return static_cast<size_t>(mixHash(hash + (row + 1) * 0x9e3779b97f4a7c15ULL) % WIDTH);
+    }
+
+public:
+    void add(uint64_t hash, uint32_t weight)
+    {
+        for (size_t row = 0; row < DEPTH; ++row)
+        {
+            counters[row * WIDTH + column(hash, row)] += weight;
+        }
+        total += weight;
+    }
+
+    uint64_t estimate(uint64_t hash) const
+    {
+        uint64_t result = numeric_limits<uint64_t>::max();
+        for (size_t row = 0; row < DEPTH; ++row)
+        {
+            result = min<uint64_t>(result, counters[row * WIDTH + column(hash, row)]);
+        }
+        return result;
+    }
+
+    void merge(const CountMinSketch &other)
+    {
+        for (size_t i = 0; i < counters.size(); ++i)
+        {
+            counters[i] += other.counters[i];
+        }
+        total += other.total;
+    }
+
+    uint64_t getTotal() const
+    {
+        return total;
+    }
+
+    // Overcount bound that holds for about 98% of estimates
+    uint64_t errorBound() const
+    {
+        return static_cast<uint64_t>(ceil(exp(1.0) / WIDTH * total));
+    }
+
+    void clear()
+    {
+        fill(counters.begin(), counters.end(), 0);
+        total = 0;
+    }
+};
+
+// HyperLogLog distinct counter in 2^PRECISION one-byte registers; the standard error of
+// an estimate is 1.04 / sqrt(2^PRECISION), about 1.6%
+class HyperLogLog
+{
+public:
+    static const int PRECISION = 12;
+    static const size_t REGISTERS = size_t(1) << PRECISION;
+
+private:
+    vector<uint8_t> registers = vector<uint8_t>(REGISTERS, 0);
+
+public:
+    void add(uint64_t hash)
+    {
+        size_t index = hash >> (64 - PRECISION);
+        uint64_t rest = (hash << PRECISION) | (uint64_t(1) << (PRECISION - 1));
+        uint8_t rank = static_cast<uint8_t>(64 - LatencyBuckets::highestBit(rest));
+        registers[index] = max(registers[index], rank);
+    }
+
+    void merge(const HyperLogLog &other)
+    {
+        for (size_t i = 0; i < REGISTERS; ++i)
+        {
+            registers[i] = max(registers[i], other.registers[i]);
+        }
+    }
+
+    double estimate() const
+    {
+        double sum = 0;
+        size_t zeros = 0;
+        for (uint8_t rank : registers)
+        {
+            sum += ldexp(1.0, -rank);
+            zeros += rank == 0;
+        }
+        double m = REGISTERS;
+        double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+        if (estimate <= 2.5 * m && zeros > 0)
+        {
+            estimate = m * log(m / zeros); // Linear counting is more accurate for small sets
+        }
+        return estimate;
+    }
+
+    static double relativeError()
+    {
+        return 1.04 / sqrt(double(REGISTERS));
+    }
+
+    void clear()
+    {
+        fill(registers.begin(), registers.end(), 0);
+    }
+};
+
+// Fixed-memory sales history: one count-min sketch of units sold per product and one
+// HyperLogLog of distinct products per local calendar day, as the exact daily rollup
+// counts days, in a ring covering the last DAYS days. Memory does not grow with the
+// catalog or the length of the history; orders older than the ring are not counted.
+class ApproximateSales
+{
+public:
+    static const int64_t DAYS = 367;
+    static const int64_t DAY_SECONDS = 24 * 60 * 60;
+
+    // Sketches merged over a range of days
+    struct Summary
+    {
+        CountMinSketch units;
+        HyperLogLog products;
+        size_t orderCount = 0;
+        int64_t revenue = 0; // Exact, in cents
+    };
+
+private:
+    struct Day
+    {
+        int64_t day = -1;
+        CountMinSketch units;
+        HyperLogLog products;
+        size_t orderCount = 0;
+        int64_t revenue = 0;
+    };
+
+    vector<Day> ring = vector<Day>(DAYS);
+
+public:
+    void addOrder(const OrderView &order)
+    {
+        int64_t day = localDay(order.getOrderDate());
+        Day &slot = ring[((day % DAYS) + DAYS) % DAYS];
+        if (slot.day > day)
+        {
+            return; // Older than the ring covers
+        }
+        if (slot.day < day)
+        {
+            slot.day = day;
+            slot.units.clear();
+            slot.products.clear();
+            slot.orderCount = 0;
+            slot.revenue = 0;
+        }
+        const int32_t *quantities = order.getQuantities();
+        for (size_t i = 0; i < order.getLineCount(); ++i)
+        {
+            uint64_t hash = mixHash(hashKey(order.getProductName(i)));
+            slot.units.add(hash, static_cast<uint32_t>(max(quantities[i], 0)));
+            slot.products.add(hash);
+        }
+        slot.orderCount++;
+        slot.revenue += order.getRevenue();
+    }
+
+    // Orders on the local days containing startTime through endTime (whole days)
+    Summary summarize(time_t startTime, time_t endTime) const
+    {
+        Summary summary;
+        int64_t firstDay = localDay(startTime);
+        int64_t lastDay = localDay(endTime);
+        for (const auto &slot : ring)
+        {
+            if (slot.day >= firstDay && slot.day <= lastDay)
+            {
+                summary.units.merge(slot.units);
+                summary.products.merge(slot.products);
+                summary.orderCount += slot.orderCount;
+                summary.revenue += slot.revenue;
+            }
+        }
+        return summary;
+    }
+};
+
+// Report windows the warehouse keeps running totals for
+enum SalesPeriod
+{
+    LAST_WEEK,
+    LAST_MONTH,
+    LAST_YEAR,
+    SALES_PERIOD_COUNT
+};
+
+// Binary snapshot of the inventory and order history. The file is a header followed by
+// four arrays of fixed-width records (products, order product names, orders, order lines)
+// in native byte order, so each section loads with a single read.
+const char SNAPSHOT_MAGIC[8] = {'W', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 2; // 2: prices in cents, unit price on every order line
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t productCount;
+    uint64_t nameCount;
+    uint64_t orderCount;
+    uint64_t lineCount;
+    uint64_t checksum; // FNV-1a over all record sections
+    uint64_t reserved;
+};
+
+struct ProductRecord
+{
+    char productID[16];
+    char name[48];
+    int32_t quantity;
+    int32_t reserved;
+    int64_t price; // In cents
+};
+
+struct NameRecord
+{
+    char name[48];
+};
+
+struct OrderRecord
+{
+    char orderID[16];
+    int64_t orderDate;
+    uint64_t firstLine;
+    uint64_t lineCount;
+};
+
+struct OrderLineRecord
+{
+    uint32_t nameIndex;
+    int32_t quantity;
+    int64_t unitPrice; // In cents, or Order::UNKNOWN_PRICE
+};
+
+// Copies text into a fixed-width, NUL-padded record field; false if it does not fit
+template <size_t N> bool packField(char (&field)[N], const string &text)
+{
+    if (text.size() >= N)
+    {
+        return false;
+    }
+    memset(field, 0, N);
+    memcpy(field, text.data(), text.size());
+    return true;
+}
+
+template <size_t N> string unpackField(const char (&field)[N])
+{
+    return string(field, strnlen(field, N));
+}
+
+template <typename T> uint64_t hashRecords(const vector<T> &records, uint64_t seed)
+{
+    return hashKey(string_view(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(T)), seed);
+}
+
+uint64_t snapshotChecksum(const vector<ProductRecord> &products, const vector<NameRecord> &names,
+                          const vector<OrderRecord> &orders, const vector<OrderLineRecord> &lines)
+{
+    uint64_t hash = hashRecords(products, 14695981039346656037ULL);
+    hash = hashRecords(names, hash);
+    hash = hashRecords(orders, hash);
+    return hashRecords(lines, hash);
+}
+
+template <typename T> void writeRecords(ofstream &outFile, const vector<T> &records)
+{
+    outFile.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(T));
+}
+
+// Reads count records, failing without allocating if they would run past the
+// remainingBytes left in the file; remainingBytes is reduced by what was read
+template <typename T> bool readRecords(ifstream &inFile, vector<T> &records, uint64_t count, uint64_t &remainingBytes)
+{
+    if (count > remainingBytes / sizeof(T))
+    {
+        return false;
+    }
+    remainingBytes -= count * sizeof(T);
+    records.resize(count);
+    inFile.read(reinterpret_cast<char *>(records.data()), count * sizeof(T));
+    return static_cast<uint64_t>(inFile.gcount()) == count * sizeof(T);
+}
+
+// Forces a file's contents to stable storage
+bool syncFile(FILE *file)
+{
+    if (fflush(file) != 0)
+    {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Replaces target with the freshly written temp file, durably
+bool replaceFile(const string &tempFilename, const string &target)
+{
+    FILE *file = fopen(tempFilename.c_str(), "rb+");
+    bool synced = file && syncFile(file);
+    if (file)
+    {
+        fclose(file);
+    }
+    if (!synced)
+    {
+        return false;
+    }
+#ifdef _WIN32
+    remove(target.c_str());
+    return rename(tempFilename.c_str(), target.c_str()) == 0;
+#else
+    if (rename(tempFilename.c_str(), target.c_str()) != 0)
+    {
+        return false;
+    }
+    // The rename is only durable once the directory holding it is synced
+    size_t slash = target.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : target.substr(0, slash);
+    int directoryFd = open(directory.c_str(), O_RDONLY);
+    if (directoryFd < 0)
+    {
+        return false;
+    }
+    bool directorySynced = fsync(directoryFd) == 0;
+    close(directoryFd);
+    return directorySynced;
+#endif
+}
+
+// Append-only mutation journal. Each line is one transaction: a checksum followed by
+// tab-separated records. Commits are buffered and a background thread writes and syncs
+// whatever has accumulated in one go (group commit), so back-to-back commits share a sync.
+class Journal
+{
+private:
+    static const int GROUP_COMMIT_MS = 2;         // How long a group waits for more commits
+    static const size_t GROUP_COMMIT_BYTES = 1 << 16; // Flush early once this much is pending
+
+    FILE *file = nullptr;
+    string pending;    // Transactions not yet written
+    string unwritten;  // Transactions dropped since a write failed, for compaction to recover
+    uint64_t appendedSeq = 0;
+    uint64_t durableSeq = 0;
+    size_t fileSize = 0;
+    bool failed = false; // A write failed; nothing more is acknowledged until truncate
+    bool stopping = false;
+    mutex lock;
+    condition_variable pendingReady;
+    condition_variable durable;
+    thread flusher;
+    function<void()> lockFile, unlockFile; // Held around writes to a file other processes share
+
+    static string formatTransaction(const vector<string> &records)
+    {
+        string payload;
+        for (const auto &record : records)
+        {
+            if (!payload.empty())
+            {
+                payload += '\t';
+            }
+            payload += record;
+        }
+        char checksum[17];
+        snprintf(checksum, sizeof(checksum), "%016llx", static_cast<unsigned long long>(hashKey(payload)));
+        return string(checksum) + " " + payload + "\n";
+    }
+
+    void flushLoop()
+    {
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            pendingReady.wait(guard, [&] { return stopping || !pending.empty(); });
+            if (pending.empty())
+            {
+                break;
+            }
+            // Give other committers a moment to join this group
+            pendingReady.wait_for(guard, chrono::milliseconds(GROUP_COMMIT_MS),
+                                  [&] { return stopping || pending.size() >= GROUP_COMMIT_BYTES; });
+
+            string batch;
+            batch.swap(pending);
+            uint64_t batchSeq = appendedSeq;
+            if (failed)
+            {
+                // Anything after a torn write would be unreadable; truncate recovers
+                unwritten += batch;
+                durable.notify_all();
+                continue;
+            }
+            guard.unlock();
+            if (lockFile)
+            {
+                lockFile();
+            }
+            bool written = fwrite(batch.data(), 1, batch.size(), file) == batch.size() && syncFile(file);
+            long end = ftell(file); // Past other processes' writes too
+            if (unlockFile)
+            {
+                unlockFile();
+            }
+            guard.lock();
+            if (!written)
+            {
+                cerr << "Journal write failed; changes are not acknowledged until the journal is compacted."
+                     << endl;
+                unwritten += batch;
+                failed = true;
+            }
+            else
+            {
+                fileSize = end >= 0 ? static_cast<size_t>(end) : fileSize + batch.size();
+                durableSeq = batchSeq;
+            }
+            durable.notify_all();
+        }
+    }
+
+public:
+    ~Journal()
+    {
+        close();
+    }
+
+    // Has the flusher hold a lock while it writes, for a journal other processes append to
+    // too. Call before open.
+    void shareFile(function<void()> lock, function<void()> unlock)
+    {
+        lockFile = move(lock);
+        unlockFile = move(unlock);
+    }
+
+    // Opens the journal for appending, discarding anything past validLength (a torn tail
+    // left by a crash)
+    bool open(const string &filename, size_t validLength)
+    {
+        file = fopen(filename.c_str(), "ab+");
+        if (!file)
+        {
+            return false;
+        }
+        // Unbuffered, so each batch goes out in a single append that cannot interleave with
+        // another process's batches
+        setvbuf(file, nullptr, _IONBF, 0);
+        fseek(file, 0, SEEK_END);
+        size_t currentLength = static_cast<size_t>(ftell(file));
+        if (currentLength > validLength)
+        {
+#ifdef _WIN32
+            _chsize_s(_fileno(file), validLength);
+#else
+            if (ftruncate(fileno(file), validLength) != 0)
+            {
+                cerr << "Unable to discard the torn tail of " << filename << endl;
+            }
+#endif
+        }
+        fileSize = min(currentLength, validLength);
+        stopping = false;
+        flusher = thread(&Journal::flushLoop, this);
+        return true;
+    }
+
+    bool isOpen() const
+    {
+        return file != nullptr;
+    }
+
+    // Queues one transaction and returns its sequence number for waitDurable
+    uint64_t append(const vector<string> &records)
+    {
+        string transaction = formatTransaction(records);
+        lock_guard<mutex> guard(lock);
+        pending += transaction;
+        pendingReady.notify_one();
+        return ++appendedSeq;
+    }
+
+    // Returns true once the transaction is on stable storage, or false if the journal
+    // failed before it got there
+    bool waitDurable(uint64_t seq)
+    {
+        unique_lock<mutex> guard(lock);
+        durable.wait(guard, [&] { return durableSeq >= seq || failed; });
+        return durableSeq >= seq;
+    }
+
+    // Returns once every transaction appended so far is on stable storage; false if the
+    // journal failed first
+    bool sync()
+    {
+        unique_lock<mutex> guard(lock);
+        durable.wait(guard, [&] { return durableSeq >= appendedSeq || failed; });
+        return durableSeq >= appendedSeq;
+    }
+
+    // Appends one transaction and returns once it is on stable storage; false if it
+    // could not be written. seq is set to its sequence number, or 0 if the journal is closed.
+    bool commit(const vector<string> &records, uint64_t &seq)
+    {
+        seq = file ? append(records) : 0;
+        return waitDurable(seq);
+    }
+    bool commit(const vector<string> &records)
+    {
+        uint64_t seq;
+        return commit(records, seq);
+    }
+
+    // Sequence number of the last transaction on stable storage
+    uint64_t durableSequence()
+    {
+        lock_guard<mutex> guard(lock);
+        return durableSeq;
+    }
+
+    // Writes one transaction straight to the file and syncs it, for a caller holding the
+    // file lock the flusher would wait for. Call with nothing pending.
+    bool writeNow(const vector<string> &records)
+    {
+        string transaction = formatTransaction(records);
+        lock_guard<mutex> guard(lock);
+        if (fwrite(transaction.data(), 1, transaction.size(), file) != transaction.size() || !syncFile(file))
+        {
+            return false;
+        }
+        fileSize += transaction.size();
+        return true;
+    }
+
+    size_t size()
+    {
+        lock_guard<mutex> guard(lock);
+        return fileSize + pending.size();
+    }
+
+    // The transactions a failed journal has not written and never will
+    string unwrittenTransactions()
+    {
+        lock_guard<mutex> guard(lock);
+        return failed ? unwritten + pending : string();
+    }
+
+    // Empties the journal once its contents have been compacted into the data files.
+    // Transactions a failed journal never wrote are in those files too, so the journal
+    // recovers and acknowledges them.
+    void truncate()
+    {
+        unique_lock<mutex> guard(lock);
+        durable.wait(guard, [&] { return durableSeq == appendedSeq || failed; });
+#ifdef _WIN32
+        bool truncated = _chsize_s(_fileno(file), 0) == 0;
+#else
+        bool truncated = ftruncate(fileno(file), 0) == 0;
+#endif
+        if (!truncated)
+        {
+            cerr << "Unable to truncate the journal." << endl;
+            return;
+        }
+        fileSize = 0;
+        unwritten.clear();
+        if (failed)
+        {
+            pending.clear();
+            durableSeq = appendedSeq;
+            failed = false;
+            durable.notify_all();
+        }
+    }
+
+    void close()
+    {
+        if (!file)
+        {
+            return;
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            pendingReady.notify_one();
+        }
+        flusher.join();
+        fclose(file);
+        file = nullptr;
+    }
+};
+
+const char INVENTORY_STORE_MAGIC[8] = {'W', 'M', 'S', 'S', 'T', 'O', 'R', 'E'};
+const uint32_t INVENTORY_STORE_VERSION = 1;
+
+// Inventory kept in a memory-mapped file of fixed-size records, one per product, updated
+// in place. A stock or price change rewrites a few bytes of one record instead of the
+// whole inventory file, and sync flushes only the pages changed since the last sync, so
+// persisting changes costs the same however large the catalog is. Slots freed by removed
+// products are reused. Which slots are free is rebuilt from the records on open, so the
+// file has no header state a crash could leave stale.
+class InventoryStore
+{
+public:
+    // The fields stock and price changes write come first, so those writes touch the
+    // record's first cache line only
+    struct Record
+    {
+        int32_t quantity;
+        int32_t reserved;
+        int64_t price; // In cents
+        char productID[24];
+        char name[88]; // NUL-padded; an empty productID marks a free slot
+    };
+    static_assert(sizeof(Record) == 128, "store records are two cache lines");
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        char reserved[112]; // Pads the header to one record so records stay aligned
+    };
+    static_assert(sizeof(Header) == sizeof(Record), "the header fills one record slot");
+
+    static const size_t INITIAL_CAPACITY = 1024;
+
+    int fd = -1;
+    char *base = nullptr;
+    size_t mappedLength = 0;
+    size_t capacity = 0;                      // Record slots in the file
+    size_t slotEnd = 0;                       // One past the highest slot in use
+    bool created = false;                     // The file did not exist or was empty
+    unordered_map<string, uint32_t> slots;    // Product ID -> slot
+    vector<uint32_t> freeSlots;               // Free slots below slotEnd, lowest last
+    size_t dirtyBegin = SIZE_MAX, dirtyEnd = 0; // Byte range written since the last sync
+
+    Record &record(size_t slot)
+    {
+        return reinterpret_cast<Record *>(base + sizeof(Header))[slot];
+    }
+    const Record &record(size_t slot) const
+    {
+        return reinterpret_cast<const Record *>(base + sizeof(Header))[slot];
+    }
+
+    void touch(const void *data, size_t length)
+    {
+        size_t offset = static_cast<const char *>(data) - base;
+        dirtyBegin = min(dirtyBegin, offset);
+        dirtyEnd = max(dirtyEnd, offset + length);
+    }
+
+    // Resizes the file to hold newCapacity records and maps all of it
+    bool map(size_t newCapacity)
+    {
+#ifdef _WIN32
+        (void)newCapacity;
+        return false;
+#else
+        size_t length = sizeof(Header) + newCapacity * sizeof(Record);
+        if (ftruncate(fd, length) != 0)
+        {
+            return false;
+        }
+        void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+        if (base)
+        {
+            munmap(base, mappedLength);
+        }
+        base = static_cast<char *>(mapping);
+        mappedLength = length;
+        capacity = newCapacity;
+        return true;
+#endif
+    }
+
+public:
+    InventoryStore() = default;
+    InventoryStore(const InventoryStore &) = delete;
+    InventoryStore &operator=(const InventoryStore &) = delete;
+
+    ~InventoryStore()
+    {
+        close();
+    }
+
+    // Whether a product's ID and name fit in a record
+    static bool fits(const string &productID, const string &name)
+    {
+        return !productID.empty() && productID.size() < sizeof(Record::productID) &&
+               name.size() < sizeof(Record::name);
+    }
+
+    // Opens the store, creating it if it does not exist. On failure returns false and sets error.
+    bool open(const string &filename, string &error)
+    {
+#ifdef _WIN32
+        (void)filename;
+        error = "inventory stores are not supported on this platform";
+        return false;
+#else
+        fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0)
+        {
+            error = strerror(errno);
+            close();
+            return false;
+        }
+        size_t fileSize = static_cast<size_t>(info.st_size);
+        created = fileSize == 0;
+        if (!created && (fileSize < sizeof(Header) || (fileSize - sizeof(Header)) % sizeof(Record) != 0))
+        {
+            error = "not an inventory store";
+            close();
+            return false;
+        }
+        if (!map(created ? INITIAL_CAPACITY : (fileSize - sizeof(Header)) / sizeof(Record)))
+        {
+            error = strerror(errno);
+            close();
+            return false;
+        }
+
+        Header &header = *reinterpret_cast<Header *>(base);
+        if (created)
+        {
+            memcpy(header.magic, INVENTORY_STORE_MAGIC, sizeof(header.magic));
+            header.version = INVENTORY_STORE_VERSION;
+            header.recordSize = sizeof(Record);
+            touch(&header, sizeof(header));
+            return true;
+        }
+        if (memcmp(header.magic, INVENTORY_STORE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != INVENTORY_STORE_VERSION || header.recordSize != sizeof(Record))
+        {
+            error = "not an inventory store of this version";
+            close();
+            return false;
+        }
+
+        for (size_t slot = 0; slot < capacity; ++slot)
+        {
+            Record &entry = record(slot);
+            if (entry.productID[0] == '\0')
+            {
+                continue;
+            }
+            if (!slots.emplace(unpackField(entry.productID), static_cast<uint32_t>(slot)).second)
+            {
+                cerr << filename << ": duplicate product " << unpackField(entry.productID) << " dropped" << endl;
+                memset(&entry, 0, sizeof(entry));
+                touch(&entry, sizeof(entry));
+                continue;
+            }
+            slotEnd = slot + 1;
+        }
+        for (size_t slot = slotEnd; slot-- > 0;)
+        {
+            if (record(slot).productID[0] == '\0')
+            {
+                freeSlots.push_back(static_cast<uint32_t>(slot));
+            }
+        }
+        return true;
+#endif
+    }
+
+    bool isOpen() const
+    {
+        return base != nullptr;
+    }
+
+    // True if open created the file rather than opening an existing store
+    bool wasCreated() const
+    {
+        return created;
+    }
+
+    size_t size() const
+    {
+        return slots.size();
+    }
+
+    // Calls f(const Product &) for every stored product in slot order
+    template <typename F> void forEachProduct(F f) const
+    {
+        for (size_t slot = 0; slot < slotEnd; ++slot)
+        {
+            const Record &entry = record(slot);
+            if (entry.productID[0] != '\0')
+            {
+                f(Product(unpackField(entry.productID), unpackField(entry.name), entry.quantity, entry.price));
+            }
+        }
+    }
+
+    // Writes the product's current state, adding it if its ID is new. Only fields that
+    // changed are written. Returns false if it does not fit or the file cannot grow.
+    bool put(const Product &product)
+    {
+        auto it = slots.find(product.getProductID());
+        if (it == slots.end())
+        {
+            if (!fits(product.getProductID(), product.getName()))
+            {
+                return false;
+            }
+            uint32_t slot;
+            if (!freeSlots.empty())
+            {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            else
+            {
+                if (slotEnd == capacity && !map(capacity * 2))
+                {
+                    return false;
+                }
+                slot = static_cast<uint32_t>(slotEnd++);
+            }
+            slots.emplace(product.getProductID(), slot);
+            Record &entry = record(slot);
+            entry.quantity = product.getQuantity();
+            entry.price = product.getPrice();
+            packField(entry.name, product.getName());
+            packField(entry.productID, product.getProductID()); // Makes the slot live
+            touch(&entry, sizeof(entry));
+            return true;
+        }
+
+        Record &entry = record(it->second);
+        if (entry.quantity != product.getQuantity())
+        {
+            entry.quantity = product.getQuantity();
+            touch(&entry.quantity, sizeof(entry.quantity));
+        }
+        if (entry.price != product.getPrice())
+        {
+            entry.price = product.getPrice();
+            touch(&entry.price, sizeof(entry.price));
+        }
+        if (strncmp(entry.name, product.getName().c_str(), sizeof(entry.name)) != 0)
+        {
+            if (!packField(entry.name, product.getName()))
+            {
+                return false;
+            }
+            touch(entry.name, sizeof(entry.name));
+        }
+        return true;
+    }
+
+    void erase(string_view productID)
+    {
+        auto it = slots.find(string(productID));
+        if (it == slots.end())
+        {
+            return;
+        }
+        Record &entry = record(it->second);
+        memset(&entry, 0, sizeof(entry));
+        touch(&entry, sizeof(entry));
+        freeSlots.push_back(it->second);
+        slots.erase(it);
+    }
+
+    // Flushes the pages written since the last sync to stable storage
+    bool sync()
+    {
+        if (dirtyBegin >= dirtyEnd)
+        {
+            return true;
+        }
+#ifdef _WIN32
+        return false;
+#else
+        size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = dirtyBegin / pageSize * pageSize;
+        if (msync(base + begin, dirtyEnd - begin, MS_SYNC) != 0)
+        {
+            return false;
+        }
+        dirtyBegin = SIZE_MAX;
+        dirtyEnd = 0;
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#ifndef _WIN32
+        if (base)
+        {
+            sync();
+            munmap(base, mappedLength);
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+#endif
+        base = nullptr;
+        fd = -1;
+        mappedLength = capacity = slotEnd = 0;
+        slots.clear();
+        freeSlots.clear();
+    }
+};
+
+const char SHARED_INVENTORY_MAGIC[8] = {'W', 'M', 'S', 'S', 'H', 'A', 'R', 'E'};
+const uint32_t SHARED_INVENTORY_VERSION = 4;
+
+// Inventory shared by every process on the host that opens the same POSIX shared-memory
+// segment. Each product's stock is an atomic counter in the segment that the processes'
+// Products are bound to, so stock one process reserves is gone for all of them at once
+// and no update is lost. Prices live in the segment too and are changed in place. Catalog
+// changes are made under a robust process-shared mutex; adding, removing or renaming a
+// product bumps a version number that tells the other processes to reload their copy of
+// the catalog. Order numbers come from an atomic
+// counter in the segment, so they are unique across processes. A second robust mutex
+// keeps the processes' writes to their shared journal apart from its compaction.
+//
+// The slot of a removed product is reused by the next product added. Its stock carries a
+// generation that is odd while the slot is in use and moves on when the slot is freed,
+// so a process that has not reloaded the catalog yet cannot reserve another product's
+// stock through a stale binding.
+class SharedInventory
+{
+public:
+    struct Record
+    {
+        atomic<uint64_t> stock; // Generation and quantity, as packStock makes them
+        atomic<int64_t> price;  // In cents; changed in place, so no process needs to reload
+        uint32_t nextFree;      // While the slot is free, the next free slot plus one (0 for none)
+        char productID[24];
+        char name[88];
+    };
+    static_assert(atomic<uint64_t>::is_always_lock_free, "shared stock must be lock-free to work across processes");
+    static_assert(atomic<int64_t>::is_always_lock_free, "shared prices must be lock-free to work across processes");
+
+    static const size_t MAX_PROCESSES = 64;
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t capacity;       // Record slots after the header
+        atomic<uint32_t> ready;  // Set once the creating process has filled the segment
+        atomic<int32_t> creator; // ID of the process creating the segment
+        uint32_t slotEnd;        // One past the highest slot ever used
+        uint32_t freeSlots;      // First free slot below slotEnd plus one, 0 for none
+        uint32_t removed;        // Set once the last process has unlinked the segment
+        atomic<uint64_t> nextOrderNumber;
+        atomic<uint64_t> catalogVersion;
+        int32_t processes[MAX_PROCESSES]; // IDs of attached processes, 0 for a free entry
+#ifndef _WIN32
+        pthread_mutex_t lock;        // Robust and process-shared; guards everything but the atomics
+        pthread_mutex_t journalLock; // Likewise; held while writing or compacting the journal
+#endif
+    };
+
+    static const size_t MIN_CAPACITY = 4096;
+    static const int ATTACH_TIMEOUT_MS = 5000; // For a new segment to be sized and claimed
+
+    string segmentName;
+    int fd = -1;
+    Header *header = nullptr;
+    size_t mappedLength = 0;
+    bool attached = false;
+
+    static int32_t processID()
+    {
+#ifdef _WIN32
+        return 0;
+#else
+        return static_cast<int32_t>(getpid());
+#endif
+    }
+
+#ifndef _WIN32
+    static void lockRobust(pthread_mutex_t &mutex)
+    {
+        if (pthread_mutex_lock(&mutex) == EOWNERDEAD)
+        {
+            pthread_mutex_consistent(&mutex);
+        }
+    }
+#endif
+
+    static bool isDead(int32_t process)
+    {
+#ifdef _WIN32
+        (void)process;
+        return false;
+#else
+        return kill(process, 0) != 0 && errno == ESRCH;
+#endif
+    }
+
+    Record *records() const
+    {
+        return reinterpret_cast<Record *>(reinterpret_cast<char *>(header) + sizeof(Header));
+    }
+
+    bool map(size_t length, string &error)
+    {
+#ifdef _WIN32
+        (void)length;
+        error = "shared inventories are not supported on this platform";
+        return false;
+#else
+        void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            error = strerror(errno);
+            return false;
+        }
+        header = static_cast<Header *>(mapping);
+        mappedLength = length;
+        return true;
+#endif
+    }
+
+public:
+    SharedInventory() = default;
+    SharedInventory(const SharedInventory &) = delete;
+    SharedInventory &operator=(const SharedInventory &) = delete;
+
+    ~SharedInventory()
+    {
+        close();
+    }
+
+#ifndef _WIN32
+    // Sizes the segment for at least capacityHint products and sets it up empty, claimed
+    // by this process. A segment taken over from a creator that died is wiped first;
+    // processes waiting for it only read ready and creator until it is published.
+    bool initialize(size_t capacityHint, string &error)
+    {
+        struct stat info;
+        size_t capacity = max(MIN_CAPACITY, capacityHint * 2);
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) > sizeof(Header))
+        {
+            // Never shrink a segment others may have mapped
+            capacity = max(capacity, (static_cast<size_t>(info.st_size) - sizeof(Header)) / sizeof(Record));
+        }
+        size_t length = sizeof(Header) + capacity * sizeof(Record);
+        if (header)
+        {
+            munmap(header, mappedLength);
+            header = nullptr;
+        }
+        if (ftruncate(fd, length) != 0 || !map(length, error))
+        {
+            error = error.empty() ? strerror(errno) : error;
+            return false;
+        }
+        header->creator.store(processID(), memory_order_relaxed);
+        memcpy(header->magic, SHARED_INVENTORY_MAGIC, sizeof(header->magic));
+        header->version = SHARED_INVENTORY_VERSION;
+        header->capacity = static_cast<uint32_t>(capacity);
+        header->slotEnd = 0;
+        header->freeSlots = 0;
+        header->removed = 0;
+        header->nextOrderNumber = 1;
+        header->catalogVersion = 0;
+        memset(header->processes, 0, sizeof(header->processes));
+        memset(static_cast<void *>(records()), 0, capacity * sizeof(Record));
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header->lock, &attributes);
+        pthread_mutex_init(&header->journalLock, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+        return true;
+    }
+#endif
+
+    // Opens the segment called name, creating it with room for at least capacityHint
+    // products if it does not exist; created tells which happened. A process that creates
+    // the segment must fill it and call publish; until then others wait in open. If the
+    // creator dies first, one of the waiting processes takes the segment over and creates
+    // it afresh instead.
+    bool open(const string &name, size_t capacityHint, bool &created, string &error)
+    {
+#ifdef _WIN32
+        (void)name;
+        (void)capacityHint;
+        created = false;
+        error = "shared inventories are not supported on this platform";
+        return false;
+#else
+        segmentName = "/" + name;
+        do
+        {
+            fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            created = fd >= 0;
+            if (created)
+            {
+                if (!initialize(capacityHint, error))
+                {
+                    close();
+                    shm_unlink(segmentName.c_str());
+                    return false;
+                }
+                return true;
+            }
+            // The segment may be removed between the two calls; then it is created afresh
+        } while (errno == EEXIST && (fd = shm_open(segmentName.c_str(), O_RDWR, 0)) < 0 && errno == ENOENT);
+        if (fd < 0)
+        {
+            error = strerror(errno);
+            return false;
+        }
+
+        // Waits as long as the creator is alive. Only a segment that is not even sized and
+        // claimed within the timeout is given up on, as its creator is unknown.
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(ATTACH_TIMEOUT_MS);
+        struct stat info;
+        while (true)
+        {
+            if (fstat(fd, &info) != 0)
+            {
+                error = strerror(errno);
+                close();
+                return false;
+            }
+            int32_t creator = 0;
+            if (static_cast<size_t>(info.st_size) >= sizeof(Header))
+            {
+                if (!header && !map(sizeof(Header), error))
+                {
+                    close();
+                    return false;
+                }
+                if (header->ready.load(memory_order_acquire))
+                {
+                    break;
+                }
+                creator = header->creator.load(memory_order_acquire);
+                if (creator != 0 && isDead(creator) &&
+                    header->creator.compare_exchange_strong(creator, processID(), memory_order_acq_rel))
+                {
+                    created = true;
+                    if (!initialize(capacityHint, error))
+                    {
+                        close();
+                        return false;
+                    }
+                    return true;
+                }
+            }
+            if (creator == 0 && chrono::steady_clock::now() >= deadline)
+            {
+                error = "segment was never initialized; remove /dev/shm" + segmentName;
+                close();
+                return false;
+            }
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+
+        // Mapped in full only now: a process taking the segment over may have grown it
+        munmap(header, mappedLength);
+        header = nullptr;
+        if (fstat(fd, &info) != 0 || !map(info.st_size, error))
+        {
+            error = error.empty() ? strerror(errno) : error;
+            close();
+            return false;
+        }
+        if (memcmp(header->magic, SHARED_INVENTORY_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != SHARED_INVENTORY_VERSION ||
+            mappedLength != sizeof(Header) + header->capacity * sizeof(Record))
+        {
+            error = "not a shared inventory of this version";
+            close();
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    // Lets processes waiting in open attach to a segment this process created
+    void publish()
+    {
+        header->ready.store(1, memory_order_release);
+    }
+
+    bool isOpen() const
+    {
+        return header != nullptr;
+    }
+
+    // Locks the segment. If the previous owner died holding the lock it is taken over;
+    // each change made under it is complete at every step, so there is nothing to undo.
+    void lock() const
+    {
+#ifndef _WIN32
+        lockRobust(header->lock);
+#endif
+    }
+    void unlock() const
+    {
+#ifndef _WIN32
+        pthread_mutex_unlock(&header->lock);
+#endif
+    }
+
+    // Locks the journal shared by the processes. A compaction that died holding it is
+    // finished by the next one from the checkpoint it left in the journal.
+    void lockJournal() const
+    {
+#ifndef _WIN32
+        lockRobust(header->journalLock);
+#endif
+    }
+    void unlockJournal() const
+    {
+#ifndef _WIN32
+        pthread_mutex_unlock(&header->journalLock);
+#endif
+    }
+
+    // The functions below other than takeOrderNumber, reserveOrderNumbers and
+    // getCatalogVersion must be called with the segment locked.
+
+    // Whether the last process to detach has removed the segment since this one opened
+    // it, leaving it to nobody; open it again by name instead
+    bool isRemoved() const
+    {
+        return header->removed != 0;
+    }
+
+    // Records this process as attached; false if too many processes already are
+    bool attach()
+    {
+        for (auto &process : header->processes)
+        {
+            if (process == 0)
+            {
+                process = processID();
+                attached = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void detach()
+    {
+        for (auto &process : header->processes)
+        {
+            if (process == processID())
+            {
+                process = 0;
+            }
+        }
+        attached = false;
+    }
+
+    // True if no other live process is attached; entries of processes that died are dropped
+    bool isAlone()
+    {
+        bool alone = true;
+        for (auto &process : header->processes)
+        {
+            if (process == 0 || process == processID())
+            {
+                continue;
+            }
+            if (isDead(process))
+            {
+                process = 0;
+                continue;
+            }
+            alone = false;
+        }
+        return alone;
+    }
+
+    // Calls f(uint32_t slot, Record &) for every live product
+    template <typename F> void forEachRecord(F f)
+    {
+        for (uint32_t slot = 0; slot < header->slotEnd; ++slot)
+        {
+            if (stockGeneration(records()[slot].stock.load(memory_order_acquire)) % 2 == 1)
+            {
+                f(slot, records()[slot]);
+            }
+        }
+    }
+
+    Record &record(uint32_t slot)
+    {
+        return records()[slot];
+    }
+
+    // Whether a product's ID and name fit in a record
+    static bool fits(const string &productID, const string &name)
+    {
+        return productID.size() < sizeof(Record::productID) && name.size() < sizeof(Record::name);
+    }
+
+    // Adds a product, reusing a free slot if there is one, and returns its slot; -1 if the
+    // segment is full or the ID or name does not fit
+    int64_t add(const Product &product)
+    {
+        if ((header->freeSlots == 0 && header->slotEnd == header->capacity) ||
+            !fits(product.getProductID(), product.getName()))
+        {
+            return -1;
+        }
+        uint32_t slot;
+        if (header->freeSlots != 0)
+        {
+            slot = header->freeSlots - 1;
+            header->freeSlots = records()[slot].nextFree;
+        }
+        else
+        {
+            slot = header->slotEnd++;
+        }
+        Record &entry = records()[slot];
+        entry.price.store(product.getPrice(), memory_order_release);
+        packField(entry.productID, product.getProductID());
+        packField(entry.name, product.getName());
+        uint32_t generation = stockGeneration(entry.stock.load(memory_order_relaxed)) + 1;
+        entry.stock.store(packStock(generation, product.getQuantity()), memory_order_release);
+        return slot;
+    }
+
+    // Frees a product's slot. Its stock moves to the next generation at once, so products
+    // still bound to it read no stock and cannot reserve any.
+    void remove(uint32_t slot)
+    {
+        Record &entry = records()[slot];
+        uint32_t generation = stockGeneration(entry.stock.load(memory_order_relaxed)) + 1;
+        entry.stock.store(packStock(generation, 0), memory_order_release);
+        entry.nextFree = header->freeSlots;
+        header->freeSlots = slot + 1;
+    }
+
+    // Marks the catalog changed and returns the new version
+    uint64_t bumpCatalogVersion()
+    {
+        return header->catalogVersion.fetch_add(1, memory_order_acq_rel) + 1;
+    }
+
+    uint64_t getCatalogVersion() const
+    {
+        return header->catalogVersion.load(memory_order_acquire);
+    }
+
+    uint64_t takeOrderNumber()
+    {
+        return header->nextOrderNumber.fetch_add(1, memory_order_relaxed);
+    }
+
+    // Makes sure no order number below next is handed out from now on
+    void reserveOrderNumbers(uint64_t next)
+    {
+        uint64_t current = header->nextOrderNumber.load(memory_order_relaxed);
+        while (current < next && !header->nextOrderNumber.compare_exchange_weak(current, next))
+        {
+        }
+    }
+
+    // Detaches and unmaps the segment. The last process to detach removes it, so the next
+    // process to start builds it again from the data files and the journal.
+    void close()
+    {
+        if (attached)
+        {
+            lock();
+            detach();
+#ifndef _WIN32
+            if (isAlone())
+            {
+                header->removed = 1;
+                shm_unlink(segmentName.c_str());
+            }
+#endif
+            unlock();
+        }
+#ifndef _WIN32
+        if (header)
+        {
+            munmap(header, mappedLength);
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+#endif
+        header = nullptr;
+        fd = -1;
+        mappedLength = 0;
+    }
+};
+
+// Files the warehouse state is persisted to
+struct DataFiles
+{
+    string inventory = "inventory.txt";
+    string orders = "orders.txt";
+    string journal = "journal.log";
+    string snapshot; // Optional binary snapshot
+};
+
+// Warehouse Class
+class Warehouse
+{
+private:
+    ShardedInventory inventory;
+    OrderHistory orders;
+    Journal journal;
+    InventoryStore inventoryStore; // Replaces inventory.txt when open
+    struct StoreWrite
+    {
+        uint64_t seq; // Journal transaction the change must wait for
+        string productID;
+        optional<Product> product; // Missing for a removal
+    };
+    deque<StoreWrite> storeWrites; // Changes not yet in the store, in journal order; guarded by commitLock
+    DataFiles dataFiles;
+
+    // Inventory shared with other processes, when open. Every product's stock is bound to
+    // its counter in the segment; the rest of the catalog is a local copy, reloaded when
+    // the segment's catalog version moves past sharedCatalogVersion.
+    SharedInventory sharedInventory;
+    bool createdSharedInventory = false;
+    unordered_map<string, uint32_t> sharedSlots; // Product ID -> slot in the segment
+    atomic<uint64_t> sharedCatalogVersion{0};
+
+    // Stock is reserved under the lock of the product's inventory shard only, so orders
+    // for different shards run in parallel. commitLock serializes every journaled change:
+    // appends to the order history and adding, removing or editing products. It is always
+    // taken before any shard lock.
+    mutable mutex commitLock;
+
+    // Sales analytics derived from the order history. Recording an order does not touch
+    // them; whoever reads them first brings them up to date from a snapshot of the history
+    // under analyticsLock. Readers hold commitLock only while taking the snapshot, so a
+    // report never holds up order placement however long it runs. analyticsLock is always
+    // taken before commitLock. With approximate sales tracking on, the sketches replace
+    // the exact orderLines and salesWindows, which stay empty.
+    mutable mutex analyticsLock;
+    mutable OrderLineStore orderLines;
+    mutable SalesWindow salesWindows[SALES_PERIOD_COUNT];
+    mutable SpaceSavingSketch topSellers;
+    mutable unique_ptr<ApproximateSales> approximateSales;
+    mutable size_t analyzedOrders = 0; // Orders of the history the analytics include
+
+    // Compact once the journal grows past this size
+    static const size_t JOURNAL_COMPACT_BYTES = 8 << 20;
+
+    // One product of an order being placed. Its ID is filled in when its stock is
+    // reserved, and the line is followed by ID from then on, so a rename before the
+    // order is recorded cannot lose track of the product.
+    struct OrderLine
+    {
+        string name;
+        int quantity;
+        string productID;
+    };
+
+    // An order being placed on a WorkStealingPool: one part per inventory shard
+    struct OrderTicket
+    {
+        time_t orderDate;
+        vector<pair<size_t, vector<OrderLine>>> parts; // (shard, lines)
+        vector<char> partReserved;
+        atomic<size_t> remainingParts{0};
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        mutex errorLock;
+        string error;
+        function<void(const optional<string> &, const string &)> done;
+    };
+
+    // Adds an order to the history, filling in any unit prices it lacks
+    void recordOrder(Order &order)
+    {
+        // Orders saved by older builds carry no prices; the catalog price is the best
+        // record left of what they sold for
+        const auto &unitPrices = order.getUnitPrices();
+        if (find(unitPrices.begin(), unitPrices.end(), Order::UNKNOWN_PRICE) != unitPrices.end())
+        {
+            const auto &productNames = order.getOrderProductNames();
+            for (size_t i = 0; i < productNames.size(); ++i)
+            {
+                if (unitPrices[i] == Order::UNKNOWN_PRICE)
+                {
+                    inventory.readByName(productNames[i],
+                                         [&](const Product &product) { order.setUnitPrice(i, product.getPrice()); });
+                }
+            }
+        }
+
+        orders.add(order);
+    }
+
+    OrderHistory::Snapshot snapshotOrders() const
+    {
+        lock_guard<mutex> commitGuard(commitLock);
+        return orders.snapshot();
+    }
+
+    // Adds the orders recorded since the last call to the analytics and returns the
+    // snapshot they now reflect. Call with analyticsLock held.
+    OrderHistory::Snapshot catchUpAnalytics() const
+    {
+        OrderHistory::Snapshot snapshot = snapshotOrders();
+        for (; analyzedOrders < snapshot.size(); ++analyzedOrders)
+        {
+            OrderView view = snapshot.view(analyzedOrders);
+            if (approximateSales)
+            {
+                approximateSales->addOrder(view);
+            }
+            else
+            {
+                orderLines.addOrder(view);
+            }
+            for (size_t i = 0; i < view.getLineCount() && topSellers.getCapacity() > 0; ++i)
+            {
+                topSellers.add(view.getProductName(i), view.getQuantities()[i]);
+            }
+        }
+        if (!approximateSales)
+        {
+            for (auto &window : salesWindows)
+            {
+                window.catchUp(orderLines);
+            }
+        }
+        return snapshot;
+    }
+
+    string nextOrderID()
+    {
+        // Numbers from the shared counter are unique across processes; the loop only skips
+        // IDs of orders loaded from older files
+        if (sharedInventory.isOpen())
+        {
+            string orderID;
+            do
+            {
+                orderID = "O" + to_string(sharedInventory.takeOrderNumber());
+            } while (orders.contains(orderID));
+            return orderID;
+        }
+        size_t number = orders.size() + 1;
+        while (orders.contains("O" + to_string(number)))
+        {
+            number++;
+        }
+        return "O" + to_string(number);
+    }
+
+    // Call without holding commitLock
+    void compactIfNeeded()
+    {
+        if (journal.isOpen() && journal.size() > JOURNAL_COMPACT_BYTES)
+        {
+            compact(true);
+        }
+    }
+
+    // Call without holding commitLock after a product change; one the journal could not
+    // write is persisted by compacting instead
+    void persistChange(bool journaled)
+    {
+        if (journaled)
+        {
+            compactIfNeeded();
+        }
+        else if (!compact())
+        {
+            cerr << "Unable to save the change; it will be lost when the program exits." << endl;
+        }
+    }
+
+    static string productRecord(const Product &product)
+    {
+        return "P|" + product.toFileFormat();
+    }
+
+    // In shared mode several processes change the same stock and their journal records
+    // interleave in no useful order, so stock is journaled as deltas, which replay the same
+    // in any order, and name and price changes as catalog records, whose stock is ignored
+    static string stockRecord(const string &id, int change)
+    {
+        return "Q|" + id + "," + to_string(change);
+    }
+    static string catalogRecord(const Product &product)
+    {
+        return "C|" + product.toFileFormat();
+    }
+
+    // Writes the product's state through to the inventory store, if there is one. Call only
+    // for a change already on stable storage, such as a replayed one; live changes go through
+    // queueStoreWrite.
+    void storeProduct(const Product &product)
+    {
+        if (inventoryStore.isOpen() && !inventoryStore.put(product))
+        {
+            cerr << "Unable to write product " << product.getProductID() << " to the inventory store." << endl;
+        }
+    }
+
+    // Queues a product change for the inventory store until journal transaction seq (0 for
+    // none) is durable. The store's pages can reach the disk at any moment, so writing it
+    // earlier could leave it ahead of the journal after a crash. A missing product means
+    // the product was removed. Call with commitLock held.
+    void queueStoreWrite(uint64_t seq, const string &productID, optional<Product> product)
+    {
+        if (inventoryStore.isOpen())
+        {
+            storeWrites.push_back({seq, productID, move(product)});
+        }
+    }
+
+    // Writes the queued changes whose journal transactions are durable, or all of them when
+    // the data files are being compacted. A change the journal failed to write stays queued
+    // until then. Call with commitLock held.
+    void writeDurableStores(bool all = false)
+    {
+        if (storeWrites.empty())
+        {
+            return;
+        }
+        uint64_t durableSeq = all || !journal.isOpen() ? UINT64_MAX : journal.durableSequence();
+        while (!storeWrites.empty() && storeWrites.front().seq <= durableSeq)
+        {
+            StoreWrite &write = storeWrites.front();
+            if (write.product)
+            {
+                storeProduct(*write.product);
+            }
+            else
+            {
+                inventoryStore.erase(write.productID);
+            }
+            storeWrites.pop_front();
+        }
+    }
+
+    // Brings the local catalog in line with the shared segment and binds each product's
+    // stock to its counter there. Call with commitLock held and the segment locked.
+    void loadSharedCatalog()
+    {
+        sharedSlots.clear();
+        sharedInventory.forEachRecord([&](uint32_t slot, SharedInventory::Record &record)
+                                      { sharedSlots.emplace(unpackField(record.productID), slot); });
+        for (const auto &product : inventory.getProducts())
+        {
+            if (!sharedSlots.count(product.getProductID()))
+            {
+                inventory.remove(product.getProductID());
+            }
+        }
+        for (const auto &entry : sharedSlots)
+        {
+            SharedInventory::Record &record = sharedInventory.record(entry.second);
+            string name = unpackField(record.name);
+            string error;
+            if (!inventory.readByID(entry.first, [](const Product &) {}))
+            {
+                inventory.add(Product(entry.first, name, 0, record.price.load(memory_order_acquire)));
+            }
+            else if (!inventory.rename(entry.first, name, error))
+            {
+                cerr << "Shared inventory renames " << entry.first << " to a name in use: " << name << endl;
+            }
+            inventory.updateByID(entry.first,
+                                 [&](Product &product) { product.bindSlot(&record.stock, &record.price); });
+        }
+        sharedCatalogVersion = sharedInventory.getCatalogVersion();
+    }
+
+    // Copies the catalog into a segment this process created and lets the processes
+    // waiting for it attach. Call with commitLock held and the segment locked.
+    void fillSharedInventory()
+    {
+        for (const auto &product : inventory.getProducts())
+        {
+            int64_t slot = sharedInventory.add(product);
+            if (slot < 0)
+            {
+                cerr << "Product ID or name too long for the shared inventory; dropped "
+                     << product.getProductID() << endl;
+                inventory.remove(product.getProductID());
+                continue;
+            }
+            sharedSlots[product.getProductID()] = static_cast<uint32_t>(slot);
+            inventory.updateByID(product.getProductID(), [&](Product &existing)
+                                 {
+                                     SharedInventory::Record &record = sharedInventory.record(slot);
+                                     existing.bindSlot(&record.stock, &record.price);
+                                 });
+        }
+        sharedCatalogVersion = sharedInventory.getCatalogVersion();
+        sharedInventory.publish();
+    }
+
+    // Reloads the catalog if another process has changed it since this one last looked
+    void refreshSharedCatalog()
+    {
+        if (!sharedInventory.isOpen() ||
+            sharedInventory.getCatalogVersion() == sharedCatalogVersion.load(memory_order_acquire))
+        {
+            return;
+        }
+        lock_guard<mutex> commitGuard(commitLock);
+        lock_guard<SharedInventory> sharedGuard(sharedInventory);
+        loadSharedCatalog();
+    }
+
+    // Runs f() with the segment locked and the local catalog up to date and returns its
+    // result. Call with commitLock held.
+    template <typename F> bool withSharedCatalog(F f)
+    {
+        lock_guard<SharedInventory> sharedGuard(sharedInventory);
+        if (sharedInventory.getCatalogVersion() != sharedCatalogVersion)
+        {
+            loadSharedCatalog();
+        }
+        return f();
+    }
+
+    // Runs change() like withSharedCatalog, and if it returns true tells the other processes
+    // to reload. Only changes to which products exist or what they are called need this;
+    // stock and prices are read from the segment. Call with commitLock held.
+    template <typename F> bool changeSharedCatalog(F change)
+    {
+        return withSharedCatalog(
+            [&]
+            {
+                if (!change())
+                {
+                    return false;
+                }
+                sharedCatalogVersion = sharedInventory.bumpCatalogVersion();
+                return true;
+            });
+    }
+
+    // Applies f to the product and journals the change; false if the ID is unknown. f
+    // returns how much it changed the stock by.
+    template <typename F> bool changeProduct(const string &id, F f)
+    {
+        bool journaled = false;
+        {
+            lock_guard<mutex> commitGuard(commitLock);
+            optional<Product> changed;
+            uint64_t seq = 0;
+            auto update = [&]
+            {
+                string record;
+                if (!inventory.updateByID(id,
+                                          [&](Product &product)
+                                          {
+                                              int change = f(product);
+                                              if (!sharedInventory.isOpen())
+                                              {
+                                                  record = productRecord(product);
+                                              }
+                                              else
+                                              {
+                                                  record = change != 0 ? stockRecord(id, change)
+                                                                       : catalogRecord(product);
+                                              }
+                                              changed.emplace(product.getProductID(), product.getName(),
+                                                              product.getQuantity(), product.getPrice());
+                                          }))
+                {
+                    return false;
+                }
+                journaled = journal.commit({record}, seq);
+                return true;
+            };
+            // A shared product's stock and price are written through to the segment
+            if (sharedInventory.isOpen() ? !withSharedCatalog(update) : !update())
+            {
+                return false;
+            }
+            queueStoreWrite(seq, id, move(changed));
+            writeDurableStores();
+        }
+        Stats::count(COUNTER_PRODUCTS_CHANGED);
+        persistChange(journaled);
+        return true;
+    }
+
+    // Sums repeated products so stock is checked against the whole order
+    static bool collectOrderLines(const Order &request, vector<OrderLine> &lines, string &error)
+    {
+        const auto &productNames = request.getOrderProductNames();
+        const auto &quantities = request.getQuantities();
+        if (productNames.empty())
+        {
+            error = "order has no products";
+            return false;
+        }
+        for (size_t i = 0; i < productNames.size(); ++i)
+        {
+            if (quantities[i] <= 0)
+            {
+                error = "invalid quantity for " + productNames[i];
+                return false;
+            }
+            auto it = find_if(lines.begin(), lines.end(),
+                              [&](const OrderLine &line) { return line.name == productNames[i]; });
+            if (it == lines.end())
+            {
+                lines.push_back({productNames[i], quantities[i], ""});
+            }
+            else
+            {
+                it->quantity += quantities[i];
+            }
+        }
+        return true;
+    }
+
+    // Reserves every line or, on failure, none of them
+    bool reserveLines(vector<OrderLine> &lines, string &error)
+    {
+        for (size_t reserved = 0; reserved < lines.size(); ++reserved)
+        {
+            OrderLine &line = lines[reserved];
+            ReserveResult result = inventory.reserve(line.name, line.quantity, line.productID);
+            if (result != RESERVED)
+            {
+                error = (result == PRODUCT_NOT_FOUND ? "product not found: " : "insufficient stock for ") + line.name;
+                while (reserved-- > 0)
+                {
+                    inventory.release(lines[reserved].productID, lines[reserved].quantity);
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void releaseLines(const vector<OrderLine> &lines)
+    {
+        for (const auto &line : lines)
+        {
+            inventory.release(line.productID, line.quantity);
+        }
+    }
+
+    // Records an order whose stock is already reserved and journals it with the new stock
+    // levels, returning the recorded order. A new ID is assigned if orderID is empty or
+    // already taken. Stock levels and unit prices are read under commitLock, so the last
+    // journaled level of each product is never above its real stock and every line is
+    // priced as the catalog stood when the order was recorded. Products are looked up by
+    // ID, so a line carries the product's name as of then too. In shared mode the stock
+    // is journaled as deltas instead of levels. The order is journaled but not yet synced,
+    // and the new stock levels reach an inventory store once syncJournal has synced it.
+    Order commitOrder(const vector<OrderLine> &lines, time_t orderDate, string orderID = "")
+    {
+        lock_guard<mutex> commitGuard(commitLock);
+        if (orderID.empty() || orders.contains(orderID))
+        {
+            orderID = nextOrderID();
+        }
+        Order order(orderID, orderDate);
+        vector<string> records;
+        vector<Product> changed;
+        records.push_back(""); // Order record goes first
+        for (const auto &line : lines)
+        {
+            string name = line.name;
+            int64_t unitPrice = Order::UNKNOWN_PRICE;
+            inventory.readByID(line.productID,
+                               [&](const Product &product)
+                               {
+                                   name = product.getName();
+                                   unitPrice = product.getPrice();
+                                   records.push_back(sharedInventory.isOpen()
+                                                         ? stockRecord(line.productID, -line.quantity)
+                                                         : productRecord(product));
+                                   changed.emplace_back(product.getProductID(), name, product.getQuantity(), unitPrice);
+                               });
+            order.addProduct(name, line.quantity, unitPrice);
+        }
+        records[0] = "O|" + order.toFileFormat();
+        recordOrder(order);
+        uint64_t seq = journal.isOpen() ? journal.append(records) : 0;
+        for (auto &product : changed)
+        {
+            queueStoreWrite(seq, product.getProductID(), move(product));
+        }
+        if (seq == 0)
+        {
+            writeDurableStores();
+        }
+        return order;
+    }
+
+    // Runs when the last shard of an asynchronous order has finished reserving
+    void finishTicket(OrderTicket &ticket)
+    {
+        Stats::record(STAT_PLACE_ORDER,
+                      chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - ticket.started).count());
+        Stats::count(ticket.error.empty() ? COUNTER_ORDERS_ACCEPTED : COUNTER_ORDERS_REJECTED);
+        if (!ticket.error.empty())
+        {
+            for (size_t part = 0; part < ticket.parts.size(); ++part)
+            {
+                if (ticket.partReserved[part])
+                {
+                    releaseLines(ticket.parts[part].second);
+                }
+            }
+            ticket.done(nullopt, ticket.error);
+            return;
+        }
+        vector<OrderLine> lines;
+        for (const auto &part : ticket.parts)
+        {
+            lines.insert(lines.end(), part.second.begin(), part.second.end());
+        }
+        ticket.done(commitOrder(lines, ticket.orderDate).getOrderID(), "");
+    }
+
+    // Returns the payload of one journal line, or nullopt if its checksum does not match
+    static optional<string_view> transactionPayload(string_view line)
+    {
+        uint64_t checksum = 0;
+        if (line.size() < 17 || line[16] != ' ' ||
+            from_chars(line.data(), line.data() + 16, checksum, 16).ptr != line.data() + 16 ||
+            hashKey(line.substr(17)) != checksum)
+        {
+            return nullopt;
+        }
+        return line.substr(17);
+    }
+
+    // Calls f(record) for every record of the transactions in contents from offset on and
+    // returns the offset past the last whole one, adding their number to transactions
+    template <typename F>
+    static size_t forEachJournalRecord(string_view contents, size_t offset, size_t &transactions, F f)
+    {
+        while (offset < contents.size())
+        {
+            size_t end = contents.find('\n', offset);
+            if (end == string_view::npos)
+            {
+                break; // Torn final transaction
+            }
+            optional<string_view> payload = transactionPayload(contents.substr(offset, end - offset));
+            if (!payload)
+            {
+                break;
+            }
+            while (!payload->empty())
+            {
+                f(nextField(*payload, '\t'));
+            }
+            offset = end + 1;
+            transactions++;
+        }
+        return offset;
+    }
+
+    // A compaction of a shared journal checkpoints it with a token naming the data files
+    // it wrote; everything before the checkpoint is in those files. Returns the offset
+    // just past the last checkpoint and sets token, or returns 0 if there is none.
+    static size_t findCheckpoint(string_view contents, string &token)
+    {
+        for (size_t at = contents.rfind(" K|"); at != string_view::npos && at >= 16;
+             at = contents.rfind(" K|", at - 1))
+        {
+            size_t start = at - 16;
+            size_t end = contents.find('\n', at);
+            if ((start == 0 || contents[start - 1] == '\n') && end != string_view::npos)
+            {
+                optional<string_view> payload = transactionPayload(contents.substr(start, end - start));
+                if (payload)
+                {
+                    token = string(payload->substr(2));
+                    return end + 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    static string compactionTemp(const string &target, const string &token)
+    {
+        return target + "." + token + ".tmp";
+    }
+
+    // Puts in place the data files of a compaction that checkpointed the journal but did
+    // not get to replace them. Call with the journal locked, or before any process can
+    // write to it.
+    void finishCompaction()
+    {
+        MappedFile inFile;
+        string token;
+        if (!inFile.open(dataFiles.journal) || findCheckpoint(inFile.contents(), token) == 0)
+        {
+            return;
+        }
+        for (const string *target : {&dataFiles.inventory, &dataFiles.orders})
+        {
+            string tempFilename = compactionTemp(*target, token);
+            if (ifstream(tempFilename) && !replaceFile(tempFilename, *target))
+            {
+                cerr << "Unable to replace " << *target << " with " << tempFilename << endl;
+            }
+        }
+    }
+
+    // Compacts a journal other processes append to as well. The data files are rebuilt
+    // from their last versions and the journal rather than from memory, which holds only
+    // this process's orders. The journal stays locked throughout and is checkpointed before
+    // the new files replace the old ones, so a compaction that dies on the way is finished
+    // by the next one and nothing is replayed twice. With onlyIfLarge the journal is left
+    // alone unless it is still large once locked. Call with commitLock held.
+    bool compactSharedJournal(bool onlyIfLarge)
+    {
+        journal.sync(); // Whatever is pending would need the journal lock to be written
+        sharedInventory.lockJournal();
+        bool compacted = rebuildDataFiles(onlyIfLarge);
+        sharedInventory.unlockJournal();
+        return compacted;
+    }
+
+    // Call with the journal locked
+    bool rebuildDataFiles(bool onlyIfLarge)
+    {
+        finishCompaction();
+        MappedFile journalFile;
+        string_view contents;
+        if (journalFile.open(dataFiles.journal))
+        {
+            contents = journalFile.contents();
+        }
+        string token;
+        contents.remove_prefix(findCheckpoint(contents, token));
+        string unwritten = journal.unwrittenTransactions();
+        if (onlyIfLarge && contents.size() + unwritten.size() <= JOURNAL_COMPACT_BYTES)
+        {
+            return true;
+        }
+
+        token = to_string(chrono::system_clock::now().time_since_epoch().count());
+        string inventoryTemp = compactionTemp(dataFiles.inventory, token);
+        string ordersTemp = compactionTemp(dataFiles.orders, token);
+        // Journaled orders are appended to the orders file as they are; the catalog is
+        // rebuilt in a scratch warehouse
+        ofstream ordersOut(ordersTemp, ios::binary);
+        MappedFile ordersFile;
+        if (ordersFile.open(dataFiles.orders))
+        {
+            string_view orderLines = ordersFile.contents();
+            ordersOut.write(orderLines.data(), orderLines.size());
+            if (!orderLines.empty() && orderLines.back() != '\n')
+            {
+                ordersOut << '\n';
+            }
+        }
+        Warehouse scratch;
+        scratch.loadInventoryFromFile(dataFiles.inventory);
+        size_t transactions = 0;
+        string error;
+        auto apply = [&](string_view record)
+        {
+            if (record.substr(0, 2) == "O|")
+            {
+                ordersOut << record.substr(2) << '\n';
+            }
+            else if (!scratch.applyJournalRecord(record, false, error))
+            {
+                cerr << dataFiles.journal << ": skipping record (" << error << "): " << record << endl;
+            }
+        };
+        forEachJournalRecord(contents, 0, transactions, apply);
+        forEachJournalRecord(unwritten, 0, transactions, apply);
+        ordersOut.close();
+        scratch.saveInventoryToFile(inventoryTemp);
+
+        if (!ordersOut || !journal.writeNow({"K|" + token}))
+        {
+            cerr << "Unable to compact the journal into " << dataFiles.inventory << " and " << dataFiles.orders
+                 << endl;
+            remove(inventoryTemp.c_str());
+            remove(ordersTemp.c_str());
+            return false;
+        }
+        if (!replaceFile(inventoryTemp, dataFiles.inventory) || !replaceFile(ordersTemp, dataFiles.orders))
+        {
+            // The checkpoint stands, so the next compaction tries again
+            cerr << "Unable to replace " << dataFiles.inventory << " and " << dataFiles.orders << endl;
+            return false;
+        }
+        journal.truncate();
+        return true;
+    }
+
+    // Applies one journal record; returns false if it cannot be parsed. With ordersOnly,
+    // product records are skipped.
+    bool applyJournalRecord(string_view record, bool ordersOnly, string &error)
+    {
+        string_view type = nextField(record, '|');
+        if (type != "O" && ordersOnly)
+        {
+            return true;
+        }
+        if (type == "P")
+        {
+            optional<Product> product = Product::fromFileFormat(record, error);
+            if (!product)
+            {
+                return false;
+            }
+            const string &id = product->getProductID();
+            if (!inventory.readByID(id, [](const Product &) {}))
+            {
+                if (inventory.add(*product))
+                {
+                    storeProduct(*product);
+                }
+                return true;
+            }
+            string renameError;
+            if (!inventory.rename(id, product->getName(), renameError))
+            {
+                cerr << "Journal renames " << id << " to a name in use: " << product->getName() << endl;
+            }
+            inventory.updateByID(id,
+                                 [&](Product &existing)
+                                 {
+                                     existing.updateQuantity(product->getQuantity());
+                                     existing.updatePrice(product->getPrice());
+                                     storeProduct(existing);
+                                 });
+            return true;
+        }
+        if (type == "Q")
+        {
+            size_t comma = record.rfind(',');
+            int change = 0;
+            if (comma == string_view::npos ||
+                from_chars(record.data() + comma + 1, record.data() + record.size(), change).ptr !=
+                    record.data() + record.size())
+            {
+                error = "invalid stock change";
+                return false;
+            }
+            inventory.updateByID(record.substr(0, comma),
+                                 [&](Product &existing)
+                                 {
+                                     existing.updateQuantity(max(0, existing.getQuantity() + change));
+                                     storeProduct(existing);
+                                 });
+            return true;
+        }
+        if (type == "C")
+        {
+            optional<Product> product = Product::fromFileFormat(record, error);
+            if (!product)
+            {
+                return false;
+            }
+            const string &id = product->getProductID();
+            string renameError;
+            if (inventory.readByID(id, [](const Product &) {}) &&
+                !inventory.rename(id, product->getName(), renameError))
+            {
+                cerr << "Journal renames " << id << " to a name in use: " << product->getName() << endl;
+            }
+            inventory.updateByID(id,
+                                 [&](Product &existing)
+                                 {
+                                     existing.updatePrice(product->getPrice());
+                                     storeProduct(existing);
+                                 });
+            return true;
+        }
+        if (type == "D")
+        {
+            inventory.remove(record);
+            if (inventoryStore.isOpen())
+            {
+                inventoryStore.erase(record);
+            }
+            return true;
+        }
+        if (type == "O")
+        {
+            optional<Order> order = Order::fromFileFormat(record, error);
+            if (!order)
+            {
+                return false;
+            }
+            // Orders already compacted into the data files are skipped
+            if (!orders.contains(order->getOrderID()))
+            {
+                recordOrder(*order);
+            }
+            return true;
+        }
+        error = "unknown record type";
+        return false;
+    }
+
+    // Replays committed transactions and returns the length of the valid prefix. With
+    // ordersOnly only the orders are taken, for a process whose catalog comes from a
+    // shared inventory.
+    size_t replayJournal(const string &filename, bool ordersOnly = false)
+    {
+        ScopedTimer timer(STAT_JOURNAL_REPLAY);
+        MappedFile inFile;
+        if (!inFile.open(filename))
+        {
+            return 0;
+        }
+        string_view contents = inFile.contents();
+        string token;
+        size_t transactions = 0;
+        string error;
+        size_t validLength = forEachJournalRecord(contents, findCheckpoint(contents, token), transactions,
+                                                  [&](string_view record)
+                                                  {
+                                                      if (!applyJournalRecord(record, ordersOnly, error))
+                                                      {
+                                                          cerr << filename << ": skipping record (" << error
+                                                               << "): " << record << endl;
+                                                      }
+                                                  });
+        if (validLength < contents.size())
+        {
+            cerr << filename << ": discarding " << (contents.size() - validLength) << " bytes of incomplete journal"
+                 << endl;
+        }
+        if (transactions > 0 && !ordersOnly)
+        {
+            cout << "Recovered " << transactions << " journaled change(s) from " << filename << endl;
+        }
+        return validLength;
+    }
+
+public:
+    // Tracks the best sellers of every order recorded from now on in a space-saving
+    // sketch of the given capacity, instead of exact per-product totals; call before
+    // loading to include the order history
+    void trackTopSellers(size_t capacity)
+    {
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        topSellers = SpaceSavingSketch(capacity);
+    }
+
+    // Keeps fixed-size sketches of the last year's sales for approximate reports instead
+    // of exact per-product sales, which getDailySales and getPeriodSales then no longer
+    // report; call before loading to include the order history
+    void trackApproximateSales()
+    {
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        approximateSales = make_unique<ApproximateSales>();
+    }
+
+    bool isTrackingApproximateSales() const
+    {
+        return approximateSales != nullptr;
+    }
+
+    // Sketches of the sales on the days from startTime to endTime
+    ApproximateSales::Summary getApproximateSales(time_t startTime, time_t endTime) const
+    {
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        catchUpAnalytics();
+        return approximateSales ? approximateSales->summarize(startTime, endTime) : ApproximateSales::Summary();
+    }
+
+    bool isTrackingTopSellers() const
+    {
+        return topSellers.getCapacity() > 0;
+    }
+
+    // Approximate k best sellers of all tracked orders
+    vector<SpaceSavingSketch::Entry> getTopSellers(size_t k) const
+    {
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        catchUpAnalytics();
+        return topSellers.top(k);
+    }
+
+    // Replays the journal on top of the loaded data files and starts journaling changes
+    bool openJournal(const DataFiles &files)
+    {
+        dataFiles = files;
+        // A process joining a shared inventory takes the catalog from the segment. Its
+        // journal is written by other processes too, so an incomplete tail may be one they
+        // are still writing and is left alone.
+        bool joining = sharedInventory.isOpen() && !createdSharedInventory;
+        size_t validLength = replayJournal(dataFiles.journal, joining);
+        if (sharedInventory.isOpen())
+        {
+            journal.shareFile([this] { sharedInventory.lockJournal(); }, [this] { sharedInventory.unlockJournal(); });
+        }
+        // Opened before the segment is published, so no other process is writing to the
+        // journal while its torn tail is cut off
+        bool journalOpened = journal.open(dataFiles.journal, joining ? SIZE_MAX : validLength);
+        if (sharedInventory.isOpen())
+        {
+            lock_guard<mutex> commitGuard(commitLock);
+            lock_guard<SharedInventory> sharedGuard(sharedInventory);
+            if (joining)
+            {
+                loadSharedCatalog();
+            }
+            else
+            {
+                fillSharedInventory();
+            }
+            sharedInventory.reserveOrderNumbers(orders.size() + 1);
+        }
+        if (!journalOpened)
+        {
+            cerr << "Unable to open " << dataFiles.journal << "; changes will not be journaled." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Shares the inventory with every other process that opens the shared-memory segment
+    // called name. The first process creates the segment and fills it from its catalog
+    // in openJournal; later ones take the catalog and stock from it. Call before loading
+    // the data files, which the first process first brings up to date with any compaction
+    // a crash cut short.
+    bool shareInventory(const string &name, const DataFiles &files)
+    {
+        dataFiles = files;
+        // Room for every product in the inventory file, with as many again to spare
+        size_t capacityHint = 0;
+        MappedFile inFile;
+        if (inFile.open(dataFiles.inventory))
+        {
+            string_view contents = inFile.contents();
+            capacityHint = count(contents.begin(), contents.end(), '\n');
+        }
+        string error;
+        bool removed, attached;
+        do
+        {
+            if (!sharedInventory.open(name, capacityHint, createdSharedInventory, error))
+            {
+                cerr << "Unable to open shared inventory " << name << ": " << error << endl;
+                return false;
+            }
+            // The last process to leave may have removed the segment since it was opened
+            sharedInventory.lock();
+            removed = sharedInventory.isRemoved();
+            attached = !removed && sharedInventory.attach();
+            sharedInventory.unlock();
+            if (removed)
+            {
+                sharedInventory.close();
+            }
+        } while (removed);
+        if (!attached)
+        {
+            cerr << "Too many processes share inventory " << name << endl;
+            sharedInventory.close();
+            return false;
+        }
+        if (createdSharedInventory)
+        {
+            finishCompaction();
+        }
+        return true;
+    }
+
+    // Keeps the inventory in a memory-mapped store instead of inventory.txt. A new store
+    // is filled from inventoryFile; an existing one is loaded as it stands. Call before
+    // loading orders and opening the journal, whose replay then brings the store up to date.
+    bool openInventoryStore(const string &filename, const string &inventoryFile)
+    {
+        string error;
+        if (!inventoryStore.open(filename, error))
+        {
+            cerr << "Unable to open inventory store " << filename << ": " << error << endl;
+            return false;
+        }
+        if (inventoryStore.wasCreated())
+        {
+            loadInventoryFromFile(inventoryFile);
+            for (const auto &product : inventory.getProducts())
+            {
+                storeProduct(product);
+            }
+            inventoryStore.sync();
+            return true;
+        }
+        ScopedTimer timer(STAT_LOAD_INVENTORY);
+        inventoryStore.forEachProduct(
+            [&](const Product &product)
+            {
+                if (!inventory.add(product))
+                {
+                    cerr << filename << ": duplicate product name: " << product.getName() << endl;
+                }
+            });
+        return true;
+    }
+
+    // Rewrites the data files from memory and empties the journal. Writers are held off
+    // until the journal is truncated, so no change can slip between the two. An inventory
+    // store is given the changes still queued for it and synced rather than rewritten,
+    // which only writes the pages changed since the last compaction. A journal shared with
+    // other processes is compacted by compactSharedJournal instead; onlyIfLarge is for that
+    // case.
+    bool compact(bool onlyIfLarge = false)
+    {
+        ScopedTimer timer(STAT_COMPACT);
+        lock_guard<mutex> commitGuard(commitLock);
+        if (sharedInventory.isOpen() && journal.isOpen())
+        {
+            return compactSharedJournal(onlyIfLarge);
+        }
+        // Without a journal a shared process saves from memory, once it is the last one
+        unique_lock<SharedInventory> sharedGuard;
+        if (sharedInventory.isOpen())
+        {
+            sharedGuard = unique_lock<SharedInventory>(sharedInventory);
+            if (!sharedInventory.isAlone())
+            {
+                return true;
+            }
+            replayJournal(dataFiles.journal, true);
+            if (sharedInventory.getCatalogVersion() != sharedCatalogVersion)
+            {
+                loadSharedCatalog();
+            }
+        }
+        string inventoryTemp = dataFiles.inventory + ".tmp";
+        string ordersTemp = dataFiles.orders + ".tmp";
+        bool inventorySaved;
+        if (inventoryStore.isOpen())
+        {
+            writeDurableStores(true);
+            inventorySaved = inventoryStore.sync();
+        }
+        else
+        {
+            saveInventoryToFile(inventoryTemp);
+            inventorySaved = replaceFile(inventoryTemp, dataFiles.inventory);
+        }
+        saveOrdersToFile(ordersTemp);
+        if (!inventorySaved || !replaceFile(ordersTemp, dataFiles.orders))
+        {
+            cerr << "Unable to compact the journal into " << dataFiles.inventory << " and " << dataFiles.orders
+                 << endl;
+            return false;
+        }
+        if (!dataFiles.snapshot.empty() && !saveSnapshot(dataFiles.snapshot))
+        {
+            return false;
+        }
+        if (journal.isOpen())
+        {
+            journal.truncate();
+        }
+        return true;
+    }
+
+    // Waits for journaled changes to reach stable storage, compacting if the journal is
+    // large. If the journal cannot be written the data files are rewritten instead; false
+    // if that fails too, when the changes are not durable and must not be acknowledged.
+    bool syncJournal()
+    {
+        if (!journal.isOpen())
+        {
+            return true;
+        }
+        bool synced;
+        {
+            ScopedTimer timer(STAT_JOURNAL_SYNC);
+            synced = journal.sync();
+        }
+        if (!synced)
+        {
+            return compact();
+        }
+        if (inventoryStore.isOpen())
+        {
+            lock_guard<mutex> commitGuard(commitLock);
+            writeDurableStores();
+        }
+        compactIfNeeded();
+        return true;
+    }
+
+    // Validates and places an order without any console interaction. Either every line is
+    // reserved or none is. Safe to call from several threads at once. The order is
+    // journaled but not yet synced; call syncJournal before acknowledging it. On rejection
+    // returns nullopt and sets error.
+    optional<string> placeOrder(const Order &request, string &error)
+    {
+        ScopedTimer timer(STAT_PLACE_ORDER);
+        refreshSharedCatalog();
+        vector<OrderLine> lines;
+        if (!collectOrderLines(request, lines, error) || !reserveLines(lines, error))
+        {
+            Stats::count(COUNTER_ORDERS_REJECTED);
+            return nullopt;
+        }
+        Stats::count(COUNTER_ORDERS_ACCEPTED);
+        return commitOrder(lines, request.getOrderDate()).getOrderID();
+    }
+
+    // Like placeOrder, but splits the order by inventory shard and reserves each part as a
+    // task on the pool, queued on the worker that owns that shard. done(orderID, error) is
+    // called once, from a pool thread, after the last part finishes; orderID is nullopt
+    // if the order was rejected.
+    void placeOrderAsync(WorkStealingPool &pool, const Order &request,
+                         function<void(const optional<string> &, const string &)> done)
+    {
+        refreshSharedCatalog();
+        vector<OrderLine> lines;
+        string error;
+        if (!collectOrderLines(request, lines, error))
+        {
+            Stats::count(COUNTER_ORDERS_REJECTED);
+            done(nullopt, error);
+            return;
+        }
+
+        auto ticket = make_shared<OrderTicket>();
+        ticket->orderDate = request.getOrderDate();
+        ticket->done = move(done);
+        for (auto &line : lines)
+        {
+            size_t shard = inventory.shardOf(line.name);
+            auto part = find_if(ticket->parts.begin(), ticket->parts.end(),
+                                [&](const pair<size_t, vector<OrderLine>> &p) { return p.first == shard; });
+            if (part == ticket->parts.end())
+            {
+                ticket->parts.emplace_back(shard, vector<OrderLine>());
+                part = ticket->parts.end() - 1;
+            }
+            part->second.push_back(move(line));
+        }
+        ticket->partReserved.assign(ticket->parts.size(), 0);
+        ticket->remainingParts = ticket->parts.size();
+
+        for (size_t part = 0; part < ticket->parts.size(); ++part)
+        {
+            pool.submit(
+                [this, ticket, part]
+                {
+                    string partError;
+                    ticket->partReserved[part] = reserveLines(ticket->parts[part].second, partError);
+                    if (!ticket->partReserved[part])
+                    {
+                        lock_guard<mutex> errorGuard(ticket->errorLock);
+                        if (ticket->error.empty())
+                        {
+                            ticket->error = partError;
+                        }
+                    }
+                    if (ticket->remainingParts.fetch_sub(1, memory_order_acq_rel) == 1)
+                    {
+                        finishTicket(*ticket);
+                    }
+                },
+                ticket->parts[part].first);
+        }
+    }
+
+    // Current stock of the named product, if it exists
+    optional<int> getStock(string_view name)
+    {
+        refreshSharedCatalog();
+        optional<int> stock;
+        inventory.readByName(name, [&](const Product &product) { stock = product.getQuantity(); });
+        return stock;
+    }
+
+    size_t getOrderCount() const
+    {
+        lock_guard<mutex> commitGuard(commitLock);
+        return orders.size();
+    }
+
+    // Copies of every product, ordered by ID
+    vector<Product> getProducts() const
+    {
+        return inventory.getProducts();
+    }
+
+    // Calls f(const Product &) for every product in no particular order, without copying
+    // the catalog
+    template <typename F> void forEachProduct(F f) const
+    {
+        inventory.forEachProduct(f);
+    }
+
+    // Returns false if the product ID or name is already in use or the quantity or price
+    // is negative
+    bool addProduct(const Product &product)
+    {
+        if (product.getQuantity() < 0)
+        {
+            cerr << "Product quantity cannot be negative." << endl;
+            return false;
+        }
+        if (product.getPrice() < 0)
+        {
+            cerr << "Product price cannot be negative." << endl;
+            return false;
+        }
+        bool journaled = false;
+        {
+            lock_guard<mutex> commitGuard(commitLock);
+            if (inventoryStore.isOpen() && !InventoryStore::fits(product.getProductID(), product.getName()))
+            {
+                cerr << "Product ID or name too long for the inventory store." << endl;
+                return false;
+            }
+            if (sharedInventory.isOpen() && !SharedInventory::fits(product.getProductID(), product.getName()))
+            {
+                cerr << "Product ID or name too long for the shared inventory." << endl;
+                return false;
+            }
+            uint64_t seq = 0;
+            auto add = [&]
+            {
+                if (!inventory.add(product))
+                {
+                    return false;
+                }
+                if (sharedInventory.isOpen())
+                {
+                    int64_t slot = sharedInventory.add(product);
+                    if (slot < 0)
+                    {
+                        cerr << "The shared inventory is full." << endl;
+                        inventory.remove(product.getProductID());
+                        return false;
+                    }
+                    sharedSlots[product.getProductID()] = static_cast<uint32_t>(slot);
+                    inventory.updateByID(product.getProductID(), [&](Product &added)
+                                         {
+                                             SharedInventory::Record &record = sharedInventory.record(slot);
+                                             added.bindSlot(&record.stock, &record.price);
+                                         });
+                }
+                // Journaled before other processes can see the product, so it precedes
+                // their records for it
+                journaled = journal.commit({productRecord(product)}, seq);
+                return true;
+            };
+            if (sharedInventory.isOpen() ? !changeSharedCatalog(add) : !add())
+            {
+                return false;
+            }
+            queueStoreWrite(seq, product.getProductID(), product);
+            writeDurableStores();
+        }
+        Stats::count(COUNTER_PRODUCTS_CHANGED);
+        persistChange(journaled);
+        return true;
+    }
+
+    void addOrder()
+    {
+        // Generate a new order ID
+        refreshSharedCatalog();
+        string orderID;
+        {
+            lock_guard<mutex> commitGuard(commitLock);
+            orderID = nextOrderID();
+        }
+
+        time_t now = time(0);
+        vector<OrderLine> lines;
+        string productName, productID;
+        int quantity;
+        char addMore;
+
+        cout << "Adding a new order: " << orderID << "\n";
+        cout << "Order Date and Time: " << ctime(&now);
+
+        do
+        {
+            cout << "Enter Product Name to add to order: ";
+            cin.ignore(); // Clear the buffer
+            getline(cin, productName);
+            cout << "Enter Quantity: ";
+            cin >> quantity;
+
+            // Take the stock from the product's inventory shard
+            ReserveResult result =
+                quantity > 0 ? inventory.reserve(productName, quantity, productID) : INSUFFICIENT_STOCK;
+            if (result == RESERVED)
+            {
+                lines.push_back({productName, quantity, productID});
+                cout << "Product \"" << productName << "\" found and added to the order successfully.\n";
+            }
+            else if (result == INSUFFICIENT_STOCK && inventory.readByName(productName, [](const Product &) {}))
+            {
+                cout << "Insufficient quantity in inventory.\n";
+            }
+            else
+            {
+                cout << "Product \"" << productName << "\" not found in inventory.\n";
+            }
+            cout << "Add more products to the order? (y/n): ";
+            cin >> addMore;
+
+        } while (addMore == 'y' || addMore == 'Y');
+
+        // Add the completed order to the order list and journal it with the new stock levels
+        Order order(orderID, now);
+        bool durable;
+        {
+            ScopedTimer timer(STAT_ADD_ORDER);
+            order = commitOrder(lines, now, orderID);
+            durable = syncJournal();
+        }
+
+        // Display the structured invoice, priced as the order recorded it
+        cout << "\n===================== INVOICE =====================\n";
+        cout << "Order ID: " << order.getOrderID() << "\n";
+        cout << "Date: " << ctime(&now);
+        cout << "---------------------------------------------------\n";
+        cout << "Product Name       Quantity     Price\n";
+        cout << "---------------------------------------------------\n";
+
+        const auto &productNames = order.getOrderProductNames();
+        const auto &quantities = order.getQuantities();
+        const auto &unitPrices = order.getUnitPrices();
+        for (size_t i = 0; i < productNames.size(); ++i)
+        {
+            cout << left << setw(18) << productNames[i] << setw(12) << quantities[i]
+                 << (unitPrices[i] != Order::UNKNOWN_PRICE ? formatCents(quantities[i] * unitPrices[i]) : "N/A")
+                 << "\n";
+        }
+
+        cout << "---------------------------------------------------\n";
+        cout << right << setw(44) << "Total Cost: " << formatCents(order.getRevenue()) << "\n";
+        cout << "===================================================\n";
+
+        if (durable)
+        {
+            cout << "Order " << order.getOrderID() << " added successfully!\n";
+        }
+        else
+        {
+            cout << "Order " << order.getOrderID() << " was placed but could not be saved.\n";
+        }
+        system("pause"); // Pause after generating the invoice
+    }
+
+    void viewInventory()
+    {
+        refreshSharedCatalog();
+        cout << "Inventory:" << endl;
+        for (const auto &product : inventory.getProducts())
+        {
+            product.displayProduct();
+        }
+        system("pause"); // Pause after viewing inventory
+    }
+
+    void viewOrders() const
+    {
+        cout << "Orders:" << endl;
+        OrderHistory::Snapshot snapshot = snapshotOrders();
+        for (size_t i = 0; i < snapshot.size(); ++i)
+        {
+            snapshot.view(i).displayOrder();
+        }
+        system("pause"); // Pause after viewing orders
+    }
+
+    // Products whose ID or name equals searchTerm
+    vector<Product> searchProducts(const string &searchTerm)
+    {
+        refreshSharedCatalog();
+        vector<Product> results;
+        inventory.readByID(searchTerm, [&](const Product &product) { results.push_back(product); });
+        inventory.readByName(searchTerm,
+                             [&](const Product &product)
+                             {
+                                 if (product.getProductID() != searchTerm)
+                                 {
+                                     results.push_back(product);
+                                 }
+                             });
+        return results;
+    }
+
+    void searchProduct(const string &searchTerm)
+    {
+        cout << "Search Results for: " << searchTerm << endl;
+        vector<Product> results = searchProducts(searchTerm);
+        for (const auto &product : results)
+        {
+            product.displayProduct();
+        }
+        if (results.empty())
+        {
+            cout << "No products found matching: " << searchTerm << endl;
+        }
+        system("pause"); // Pause after search results
+    }
+
+    // Returns false if the product ID is unknown
+    bool removeProduct(const string &id)
+    {
+        bool journaled = false;
+        {
+            lock_guard<mutex> commitGuard(commitLock);
+            uint64_t seq = 0;
+            auto remove = [&]
+            {
+                if (!inventory.remove(id))
+                {
+                    return false;
+                }
+                auto slot = sharedSlots.find(id);
+                if (slot != sharedSlots.end())
+                {
+                    sharedInventory.remove(slot->second);
+                    sharedSlots.erase(slot);
+                }
+                journaled = journal.commit({"D|" + id}, seq);
+                return true;
+            };
+            if (sharedInventory.isOpen() ? !changeSharedCatalog(remove) : !remove())
+            {
+                return false;
+            }
+            queueStoreWrite(seq, id, nullopt);
+            writeDurableStores();
+        }
+        Stats::count(COUNTER_PRODUCTS_CHANGED);
+        persistChange(journaled);
+        return true;
+    }
+
+    // Returns false and sets error if the ID is unknown or the name is taken
+    bool renameProduct(const string &id, const string &newName, string &error)
+    {
+        bool journaled = false;
+        {
+            lock_guard<mutex> commitGuard(commitLock);
+            if (inventoryStore.isOpen() && !InventoryStore::fits(id, newName))
+            {
+                error = "Name too long for the inventory store.";
+                return false;
+            }
+            if (sharedInventory.isOpen() && !SharedInventory::fits(id, newName))
+            {
+                error = "Name too long for the shared inventory.";
+                return false;
+            }
+            optional<Product> renamed;
+            uint64_t seq = 0;
+            auto rename = [&]
+            {
+                if (!inventory.rename(id, newName, error))
+                {
+                    return false;
+                }
+                if (sharedInventory.isOpen())
+                {
+                    packField(sharedInventory.record(sharedSlots[id]).name, newName);
+                }
+                string record;
+                inventory.readByID(id,
+                                   [&](const Product &product)
+                                   {
+                                       record = sharedInventory.isOpen() ? catalogRecord(product)
+                                                                         : productRecord(product);
+                                       renamed.emplace(product.getProductID(), product.getName(),
+                                                       product.getQuantity(), product.getPrice());
+                                   });
+                journaled = journal.commit({record}, seq);
+                return true;
+            };
+            if (sharedInventory.isOpen() ? !changeSharedCatalog(rename) : !rename())
+            {
+                return false;
+            }
+            queueStoreWrite(seq, id, move(renamed));
+            writeDurableStores();
+        }
+        Stats::count(COUNTER_PRODUCTS_CHANGED);
+        persistChange(journaled);
+        return true;
+    }
+
+    // Returns false if the product ID is unknown or the quantity is negative
+    bool setProductQuantity(const string &id, int quantity)
+    {
+        if (quantity < 0)
+        {
+            cerr << "Product quantity cannot be negative." << endl;
+            return false;
+        }
+        return changeProduct(id, [&](Product &product) { return quantity - product.updateQuantity(quantity); });
+    }
+
+    // Returns false if the product ID is unknown or the price is negative
+    bool setProductPrice(const string &id, int64_t price)
+    {
+        if (price < 0)
+        {
+            cerr << "Product price cannot be negative." << endl;
+            return false;
+        }
+        return changeProduct(id,
+                             [&](Product &product)
+                             {
+                                 product.updatePrice(price);
+                                 return 0;
+                             });
+    }
+
+    void deleteProduct(const string &id)
+    {
+        if (removeProduct(id))
+        {
+            cout << "Product deleted successfully!" << endl;
+        }
+        else
+        {
+            cout << "Product ID not found!" << endl;
+        }
+        system("pause"); // Pause after deleting a product
+    }
+
+    void updateProduct(const string &id)
+    {
+        if (inventory.readByID(id, [](const Product &) {}))
+        {
+            int choice;
+            cout << "1. Update Name\n";
+            cout << "2. Update Quantity\n";
+            cout << "3. Update Price\n";
+            cout << "Enter the attribute to update: ";
+            cin >> choice;
+
+            // The product may be deleted while waiting for input
+            switch (choice)
+            {
+            case 1:
+            {
+                string newName;
+                string error;
+                cout << "Enter new name: ";
+                cin >> newName;
+                if (renameProduct(id, newName, error))
+                {
+                    cout << "Product name updated successfully.\n";
+                }
+                else
+                {
+                    cout << error << "\n";
+                }
+                break;
+            }
+            case 2:
+            {
+                int newQty;
+                cout << "Enter new quantity: ";
+                cin >> newQty;
+                if (newQty < 0)
+                {
+                    cout << "Invalid quantity.\n";
+                }
+                else if (setProductQuantity(id, newQty))
+                {
+                    cout << "Product quantity updated successfully.\n";
+                }
+                else
+                {
+                    cout << "Product ID not found!\n";
+                }
+                break;
+            }
+            case 3:
+            {
+                string priceText;
+                int64_t newPrice;
+                cout << "Enter new price: ";
+                cin >> priceText;
+                if (!parseCents(priceText, newPrice) || newPrice < 0)
+                {
+                    cout << "Invalid price.\n";
+                }
+                else if (setProductPrice(id, newPrice))
+                {
+                    cout << "Product price updated successfully.\n";
+                }
+                else
+                {
+                    cout << "Product ID not found!\n";
+                }
+                break;
+            }
+            default:
+                cout << "Invalid choice.\n";
+            }
+        }
+        else
+        {
+            cout << "Product ID not found!\n";
+        }
+        system("pause"); // Pause after updating a product
+    }
+
+    void saveInventoryToFile(const string &filename) const
+    {
+        ofstream outFile(filename);
+        for (const auto &product : inventory.getProducts())
+        {
+            outFile << product.toFileFormat() << endl;
+        }
+        outFile.close();
+    }
+
+    void loadInventoryFromFile(const string &filename)
+    {
+        ScopedTimer timer(STAT_LOAD_INVENTORY);
+        MappedFile inFile;
+        if (!inFile.open(filename))
+        {
+            cerr << "Unable to open " << filename << " for reading." << endl;
+            return;
+        }
+        string error;
+        forEachLine(inFile.contents(),
+                    [&](string_view line, size_t lineNumber)
+                    {
+                        optional<Product> product = Product::fromFileFormat(line, error);
+                        if (!product)
+                        {
+                            cerr << filename << ":" << lineNumber << ": " << error << ": " << line << endl;
+                        }
+                        else if (!inventory.add(*product))
+                        {
+                            cerr << filename << ":" << lineNumber << ": duplicate product: " << line << endl;
+                        }
+                    });
+    }
+
+    // Writes the inventory and order history as a binary snapshot; returns false and
+    // leaves any existing snapshot untouched on failure
+    bool saveSnapshot(const string &filename) const
+    {
+        vector<ProductRecord> productRecords;
+        for (const auto &product : inventory.getProducts())
+        {
+            ProductRecord record{};
+            if (!packField(record.productID, product.getProductID()) || !packField(record.name, product.getName()))
+            {
+                cerr << "Product does not fit a snapshot record: " << product.getProductID() << endl;
+                return false;
+            }
+            record.quantity = product.getQuantity();
+            record.price = product.getPrice();
+            productRecords.push_back(record);
+        }
+
+        // The history's columns map one to one onto the name, order and line sections
+        OrderHistory::Snapshot history = orders.snapshot();
+        vector<NameRecord> nameRecords(history.getProductCount());
+        for (uint32_t nameIndex = 0; nameIndex < nameRecords.size(); ++nameIndex)
+        {
+            if (!packField(nameRecords[nameIndex].name, history.nameOf(nameIndex)))
+            {
+                cerr << "Product name does not fit a snapshot record: " << history.nameOf(nameIndex) << endl;
+                return false;
+            }
+        }
+        vector<OrderRecord> orderRecords;
+        vector<OrderLineRecord> lineRecords;
+        lineRecords.reserve(history.getLineCount());
+        for (size_t i = 0; i < history.size(); ++i)
+        {
+            OrderView order = history.view(i);
+            OrderRecord record{};
+            if (!packField(record.orderID, string(order.getOrderID())))
+            {
+                cerr << "Order does not fit a snapshot record: " << order.getOrderID() << endl;
+                return false;
+            }
+            record.orderDate = order.getOrderDate();
+            record.firstLine = lineRecords.size();
+            record.lineCount = order.getLineCount();
+            orderRecords.push_back(record);
+            for (size_t line = 0; line < order.getLineCount(); ++line)
+            {
+                lineRecords.push_back(OrderLineRecord{order.getProductIds()[line], order.getQuantities()[line],
+                                                      order.getUnitPrices()[line]});
+            }
+        }
+
+        SnapshotHeader header{};
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.headerSize = sizeof(SnapshotHeader);
+        header.productCount = productRecords.size();
+        header.nameCount = nameRecords.size();
+        header.orderCount = orderRecords.size();
+        header.lineCount = lineRecords.size();
+        header.checksum = snapshotChecksum(productRecords, nameRecords, orderRecords, lineRecords);
+
+        // Write to a temporary file and rename it over the old snapshot
+        string tempFilename = filename + ".tmp";
+        ofstream outFile(tempFilename, ios::binary | ios::trunc);
+        if (!outFile.is_open())
+        {
+            cerr << "Unable to open " << tempFilename << " for writing." << endl;
+            return false;
+        }
+        outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        writeRecords(outFile, productRecords);
+        writeRecords(outFile, nameRecords);
+        writeRecords(outFile, orderRecords);
+        writeRecords(outFile, lineRecords);
+        outFile.close();
+        if (!outFile || !replaceFile(tempFilename, filename))
+        {
+            cerr << "Unable to write snapshot " << filename << endl;
+            remove(tempFilename.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // The whole snapshot is read and verified before any product or order is added,
+    // so a failed load leaves the warehouse unchanged
+    bool loadSnapshot(const string &filename)
+    {
+        ScopedTimer timer(STAT_LOAD_SNAPSHOT);
+        ifstream inFile(filename, ios::binary);
+        if (!inFile.is_open())
+        {
+            return false;
+        }
+        SnapshotHeader header;
+        inFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!inFile || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+        {
+            cerr << filename << ": not a warehouse snapshot" << endl;
+            return false;
+        }
+        if (header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(SnapshotHeader))
+        {
+            cerr << filename << ": unsupported snapshot version " << header.version << endl;
+            return false;
+        }
+
+        // The header's counts are checked against the file size before anything is allocated
+        streamoff recordsStart = inFile.tellg();
+        inFile.seekg(0, ios::end);
+        uint64_t remainingBytes = static_cast<uint64_t>(inFile.tellg() - recordsStart);
+        inFile.seekg(recordsStart);
+
+        vector<ProductRecord> productRecords;
+        vector<NameRecord> nameRecords;
+        vector<OrderRecord> orderRecords;
+        vector<OrderLineRecord> lineRecords;
+        if (!readRecords(inFile, productRecords, header.productCount, remainingBytes) ||
+            !readRecords(inFile, nameRecords, header.nameCount, remainingBytes) ||
+            !readRecords(inFile, orderRecords, header.orderCount, remainingBytes) ||
+            !readRecords(inFile, lineRecords, header.lineCount, remainingBytes))
+        {
+            cerr << filename << ": snapshot is truncated" << endl;
+            return false;
+        }
+        if (snapshotChecksum(productRecords, nameRecords, orderRecords, lineRecords) != header.checksum)
+        {
+            cerr << filename << ": snapshot checksum mismatch" << endl;
+            return false;
+        }
+        for (const auto &record : orderRecords)
+        {
+            if (record.lineCount > lineRecords.size() || record.firstLine > lineRecords.size() - record.lineCount)
+            {
+                cerr << filename << ": order " << unpackField(record.orderID) << " has out-of-range lines" << endl;
+                return false;
+            }
+        }
+        for (const auto &line : lineRecords)
+        {
+            if (line.nameIndex >= nameRecords.size())
+            {
+                cerr << filename << ": order line has an out-of-range product name" << endl;
+                return false;
+            }
+        }
+
+        for (const auto &record : productRecords)
+        {
+            Product product(unpackField(record.productID), unpackField(record.name), record.quantity, record.price);
+            if (!inventory.add(product))
+            {
+                cerr << filename << ": duplicate product " << product.getProductID() << endl;
+            }
+        }
+        vector<string> productNames;
+        productNames.reserve(nameRecords.size());
+        for (const auto &record : nameRecords)
+        {
+            productNames.push_back(unpackField(record.name));
+        }
+        for (const auto &record : orderRecords)
+        {
+            Order order(unpackField(record.orderID), static_cast<time_t>(record.orderDate));
+            for (uint64_t i = record.firstLine; i < record.firstLine + record.lineCount; ++i)
+            {
+                order.addProduct(productNames[lineRecords[i].nameIndex], lineRecords[i].quantity,
+                                 lineRecords[i].unitPrice);
+            }
+            recordOrder(order);
+        }
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        catchUpAnalytics(); // Now rather than on the first report
+        return true;
+    }
+
+    // Call with commitLock held or while no orders are being placed
+    void saveOrdersToFile(const string &filename) const
+    {
+        ofstream outFile(filename);
+        OrderHistory::Snapshot history = orders.snapshot();
+        string line;
+        for (size_t i = 0; i < history.size(); ++i)
+        {
+            line.clear();
+            history.view(i).appendFileFormat(line);
+            line += '\n';
+            outFile << line;
+        }
+        outFile.close();
+    }
+
+    void loadOrdersFromFile(const string &filename)
+    {
+        ScopedTimer timer(STAT_LOAD_ORDERS);
+        MappedFile inFile;
+        if (!inFile.open(filename))
+        {
+            cerr << "Unable to open " << filename << " for reading." << endl;
+            return;
+        }
+        string error;
+        Order order("", 0); // Reused for every line
+        forEachLine(inFile.contents(),
+                    [&](string_view line, size_t lineNumber)
+                    {
+                        if (Order::parse(line, order, error))
+                        {
+                            recordOrder(order);
+                        }
+                        else
+                        {
+                            cerr << filename << ":" << lineNumber << ": " << error << ": " << line << endl;
+                        }
+                    });
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        catchUpAnalytics(); // Now rather than on the first report
+    }
+
+    // Per-product sales over a report period, with the snapshot of the order history they
+    // were computed from, which names the product ids
+    struct SalesFigures
+    {
+        SalesTotals totals;
+        size_t orderCount = 0;
+        OrderHistory::Snapshot history;
+    };
+
+    // Sales over local calendar days [fromDay, toDay], read from the daily rollup
+    SalesFigures getDailySales(int64_t fromDay, int64_t toDay) const
+    {
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        SalesFigures figures;
+        figures.history = catchUpAnalytics();
+        figures.orderCount = orderLines.getRollup().countOrders(fromDay, toDay);
+        figures.totals = orderLines.getRollup().totals(fromDay, toDay);
+        return figures;
+    }
+
+    // Sales since startTime, from the running totals for the given period
+    SalesFigures getPeriodSales(SalesPeriod period, time_t startTime) const
+    {
+        lock_guard<mutex> analyticsGuard(analyticsLock);
+        SalesFigures figures;
+        figures.history = catchUpAnalytics();
+        salesWindows[period].expire(orderLines, startTime);
+        figures.totals = salesWindows[period].getTotals();
+        figures.orderCount = salesWindows[period].getOrderCount();
+        return figures;
+    }
+
+    struct ProductSales
+    {
+        string name;
+        int64_t units;
+        int64_t revenue; // In cents
+    };
+
+    // Sales per product over days [fromDay, toDay], best sellers first
+    vector<ProductSales> getSalesBetween(int64_t fromDay, int64_t toDay, size_t &orderCount) const
+    {
+        SalesFigures figures = getDailySales(fromDay, toDay);
+        orderCount = figures.orderCount;
+        vector<ProductSales> sales;
+        for (uint32_t productId = 0; productId < figures.totals.size(); ++productId)
+        {
+            if (figures.totals.units[productId] > 0)
+            {
+                sales.push_back({figures.history.nameOf(productId), figures.totals.units[productId],
+                                 figures.totals.revenue[productId]});
+            }
+        }
+        sort(sales.begin(), sales.end(),
+             [](const ProductSales &a, const ProductSales &b)
+             { return a.units != b.units ? a.units > b.units : a.name < b.name; });
+        return sales;
+    }
+};
+
+// Quantity sold and revenue per product over one report window
+struct SalesData
+{
+    struct Row
+    {
+        uint32_t productId; // Interned product id
+        int64_t quantity;
+        int64_t revenue; // In cents
+    };
+
+    const OrderHistory::Snapshot *history; // Names the product ids
+    vector<Row> totals;                    // Products that sold
+
+    const string &nameOf(uint32_t productId) const
+    {
+        return history->nameOf(productId);
+    }
+};
+
+class SalesReport
+{
+public:
+    static const size_t DEFAULT_TOP_COUNT = 5;
+    static size_t topCount; // Rows shown in the top sellers tables
+    static bool approximate; // Report from the warehouse's fixed-size sketches
+
+    virtual ~SalesReport() = default;
+    virtual void generateSalesReport(Warehouse &warehouse) = 0; // Pure virtual function
+
+protected:
+    SalesData collectSalesData(const Warehouse::SalesFigures &figures)
+    {
+        const SalesTotals &totals = figures.totals;
+        SalesData salesData{&figures.history, {}};
+        for (uint32_t id = 0; id < totals.size(); ++id)
+        {
+            if (totals.units[id] != 0)
+            {
+                salesData.totals.push_back({id, totals.units[id], totals.revenue[id]});
+            }
+        }
+        return salesData;
+    }
+
+    void printBarChart(const SalesData &salesData)
+    {
+        int64_t maxSales = 0;
+        for (const auto &data : salesData.totals)
+        {
+            maxSales = max(maxSales, data.quantity);
+        }
+
+        cout << "\nSales Report Bar Chart:\n";
+        cout << "Product Name        | Sales Quantity\n";
+        cout << "-------------------------------------\n";
+
+        for (const auto &data : salesData.totals)
+        {
+            cout << setw(20) << left << salesData.nameOf(data.productId) << " | ";
+            int barLength = static_cast<int>((data.quantity / static_cast<double>(maxSales)) * 50);
+            for (int i = 0; i < barLength; ++i)
+            {
+                cout << "*";
+            }
+            cout << " " << data.quantity << endl;
+        }
+    }
+
+    void printSalesSummary(const SalesData &salesData)
+    {
+        cout << "\nSales Summary:\n";
+        cout << "Product Name        | Total Quantity Sold | Revenue\n";
+        cout << "-----------------------------------------------------\n";
+        for (const auto &data : salesData.totals)
+        {
+            cout << setw(20) << left << salesData.nameOf(data.productId) << " | " << setw(19) << data.quantity
+                 << " | $" << formatCents(data.revenue) << endl;
+        }
+    }
+
+    void printTopSellingProducts(const SalesData &salesData)
+    {
+        vector<SalesData::Row> topSales =
+            selectTopK(salesData.totals, topCount,
+                       [&](const SalesData::Row &a, const SalesData::Row &b)
+                       {
+                           return a.quantity != b.quantity
+                                      ? a.quantity > b.quantity
+                                      : salesData.nameOf(a.productId) < salesData.nameOf(b.productId);
+                       });
+
+        cout << "\nTop Selling Products:\n";
+        cout << "Product Name        | Total Quantity Sold\n";
+        cout << "-----------------------------------------\n";
+        for (const auto &data : topSales)
+        {
+            cout << setw(20) << left << salesData.nameOf(data.productId) << " | " << data.quantity << endl;
+        }
+    }
+
+    // All-time best sellers from the warehouse's heavy-hitters sketch, if it keeps one
+    void printTrackedTopSellers(const Warehouse &warehouse)
+    {
+        if (!warehouse.isTrackingTopSellers())
+        {
+            return;
+        }
+        cout << "\nTop Selling Products Since Startup (approximate):\n";
+        cout << "Product Name        | Quantity Sold (+/- error)\n";
+        cout << "-----------------------------------------\n";
+        for (const auto &entry : warehouse.getTopSellers(topCount))
+        {
+            cout << setw(20) << left << entry.item << " | " << entry.count << " (+/- " << entry.error << ")" << endl;
+        }
+    }
+
+    // Report from count-min and HyperLogLog sketches, in memory independent of catalog
+    // size and history length
+    void printApproximateReport(const Warehouse &warehouse, time_t startTime, time_t endTime)
+    {
+        ApproximateSales::Summary summary = warehouse.getApproximateSales(startTime, endTime);
+        if (summary.orderCount == 0)
+        {
+            cout << "No orders found for this period.\n";
+            return;
+        }
+
+        // The sketches keep no product names, so the current catalog supplies the candidates
+        vector<pair<string, uint64_t>> estimates;
+        warehouse.forEachProduct(
+            [&](const Product &product)
+            {
+                uint64_t units = summary.units.estimate(mixHash(hashKey(product.getName())));
+                if (units > 0)
+                {
+                    estimates.emplace_back(product.getName(), units);
+                }
+            });
+        vector<pair<string, uint64_t>> topSales =
+            selectTopK(estimates, topCount,
+                       [](const pair<string, uint64_t> &a, const pair<string, uint64_t> &b)
+                       { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+
+        cout << "\nApproximate Sales Summary (whole days since " << put_time(localtime(&startTime), "%Y-%m-%d")
+             << "):\n";
+        cout << "Units Sold: " << summary.units.getTotal() << "\n";
+        cout << "Distinct Products Sold: ~" << llround(summary.products.estimate()) << " (+/- " << fixed
+             << setprecision(1) << HyperLogLog::relativeError() * 100 << "%)\n";
+        cout << "\nTop Selling Products (estimated; each may be overcounted by up to "
+             << summary.units.errorBound() << " units, 98% confidence):\n";
+        cout << "Product Name        | Quantity Sold\n";
+        cout << "-----------------------------------------\n";
+        for (const auto &data : topSales)
+        {
+            cout << setw(20) << left << data.first << " | " << data.second << endl;
+        }
+        cout << setprecision(2);
+        printRevenue(summary.revenue, summary.orderCount, 0);
+        printAverageSales(summary.orderCount, difftime(endTime, startTime) / ApproximateSales::DAY_SECONDS);
+    }
+
+    // Revenue figures in exact cents; the per-product average is skipped if productsSold is 0
+    void printRevenue(int64_t revenue, size_t orderCount, size_t productsSold)
+    {
+        auto average = [&](size_t count) { return formatCents((revenue + int64_t(count) / 2) / int64_t(count)); };
+        cout << "\nRevenue:\n";
+        cout << "Total Revenue: $" << formatCents(revenue) << endl;
+        cout << "Average Basket: $" << average(orderCount) << endl;
+        if (productsSold > 0)
+        {
+            cout << "Average Revenue per Product Sold: $" << average(productsSold) << endl;
+        }
+    }
+
+    void printAverageSales(size_t totalOrders, double days)
+    {
+        cout << "\nAverage Sales:\n";
+        cout << "Total Orders: " << totalOrders << endl;
+        cout << "Average Orders per Day: " << (totalOrders / days) << endl;
+    }
+
+    // Every table of the exact report, for sales over a period of the given length
+    void printReport(const Warehouse &warehouse, const Warehouse::SalesFigures &figures, double days)
+    {
+        SalesData salesData = collectSalesData(figures);
+        printBarChart(salesData);
+        printSalesSummary(salesData);
+        printTopSellingProducts(salesData);
+        printTrackedTopSellers(warehouse);
+        printRevenue(accumulate(figures.totals.revenue.begin(), figures.totals.revenue.end(), int64_t(0)),
+                     figures.orderCount, salesData.totals.size());
+        printAverageSales(figures.orderCount, days);
+    }
+};
+
+// Report over the period ending now, read from the running totals the warehouse keeps
+// for that period
+class RollingSalesReport : public SalesReport
+{
+private:
+    SalesPeriod period;
+    const char *periodName;
+    time_t endTime = 0; // 0 for now
+
+public:
+    RollingSalesReport(SalesPeriod period, const char *periodName) : period(period), periodName(periodName) {}
+
+    // Ends the period at the given time instead of now, for data dated in the past
+    void setEndTime(time_t time)
+    {
+        endTime = time;
+    }
+
+    void generateSalesReport(Warehouse &warehouse) override
+    {
+        ScopedTimer timer(STAT_SALES_REPORT);
+        time_t now = endTime != 0 ? endTime : time(0);
+        tm start = *localtime(&now);
+        switch (period)
+        {
+        case LAST_WEEK:
+            start.tm_mday -= 7;
+            break;
+        case LAST_MONTH:
+            start.tm_mon -= 1;
+            break;
+        default:
+            start.tm_year -= 1;
+            break;
+        }
+        time_t startTime = mktime(&start);
+        if (approximate)
+        {
+            printApproximateReport(warehouse, startTime, now);
+            return;
+        }
+        Warehouse::SalesFigures figures = warehouse.getPeriodSales(period, startTime);
+        if (figures.orderCount == 0)
+        {
+            cout << "No orders found for the last " << periodName << ".\n";
+            return;
+        }
+        double days = difftime(now, startTime) / ApproximateSales::DAY_SECONDS;
+        printReport(warehouse, figures, days);
+    }
+};
+
+class WeeklyReport : public RollingSalesReport
+{
+public:
+    WeeklyReport() : RollingSalesReport(LAST_WEEK, "week") {}
+};
+
+class MonthlyReport : public RollingSalesReport
+{
+public:
+    MonthlyReport() : RollingSalesReport(LAST_MONTH, "month") {}
+};
+
+class YearlyReport : public RollingSalesReport
+{
+public:
+    YearlyReport() : RollingSalesReport(LAST_YEAR, "year") {}
+};
+
+// Report over any range of whole calendar days, answered from the daily rollup
+class DateRangeReport : public SalesReport
+{
+private:
+    int64_t fromDay;
+    int64_t toDay; // Inclusive
+
+public:
+    DateRangeReport(int64_t fromDay, int64_t toDay) : fromDay(fromDay), toDay(toDay) {}
+
+    void generateSalesReport(Warehouse &warehouse) override
+    {
+        ScopedTimer timer(STAT_SALES_REPORT);
+        if (approximate)
+        {
+            printApproximateReport(warehouse, dayStartTime(fromDay), dayStartTime(toDay + 1) - 1);
+            return;
+        }
+
+        Warehouse::SalesFigures figures = warehouse.getDailySales(fromDay, toDay);
+        if (figures.orderCount == 0)
+        {
+            cout << "No orders found in this date range.\n";
+            return;
+        }
+        printReport(warehouse, figures, static_cast<double>(toDay - fromDay + 1));
+    }
+};
+
+size_t SalesReport::topCount = SalesReport::DEFAULT_TOP_COUNT;
+bool SalesReport::approximate = false;
+
+// Username -> password hash map for one credentials file, loaded once and reloaded only
+// when the file changes on disk (different inode, size or modification time). Failed
+// login attempts are tracked per user for as long as the program runs.
+class CredentialDirectory
+{
+public:
+    enum LoginResult
+    {
+        LOGIN_OK,
+        LOGIN_FAILED,
+        LOGIN_LOCKED,     // This attempt used up the last try
+        LOGIN_STILL_LOCKED,
+        LOGIN_UNAVAILABLE
+    };
+
+    static const int MAX_FAILED_ATTEMPTS = 3;
+    static const int LOCK_TIME_MINUTES = 15;
+    static const size_t MAX_LOGIN_STATES = 4096; // Names with failed attempts tracked at once
+
+private:
+    struct FileIdentity
+    {
+        bool exists = false;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        uint64_t size = 0;
+        int64_t modified = 0;
+
+        bool operator==(const FileIdentity &other) const
+        {
+            return exists == other.exists && device == other.device && inode == other.inode &&
+                   size == other.size && modified == other.modified;
+        }
+    };
+
+    struct LoginState
+    {
+        int failedAttempts = 0;
+        time_t lockedUntil = 0;
+        time_t lastAttempt = 0;
+    };
+
+    string filename;
+    unordered_map<string, string> passwords;
+    unordered_map<string, LoginState> loginStates;
+    FileIdentity loadedFrom;
+    mutex lock;
+
+    FileIdentity identify() const
+    {
+        FileIdentity identity;
+        struct stat info;
+        if (stat(filename.c_str(), &info) == 0)
+        {
+            identity.exists = true;
+            identity.device = info.st_dev;
+            identity.inode = info.st_ino;
+            identity.size = info.st_size;
+            identity.modified = info.st_mtime;
+        }
+        return identity;
+    }
+
+    // Drops one login state to make room for another: unknown names go before known users,
+    // unlocked names before locked ones, and older attempts before newer. Unknown names are
+    // tracked too so that lockouts do not reveal which names exist. Call with lock held.
+    void evictLoginState(time_t now)
+    {
+        auto rank = [&](const pair<const string, LoginState> &entry)
+        { return make_tuple(passwords.count(entry.first) > 0, now < entry.second.lockedUntil, entry.second.lastAttempt); };
+        auto victim = min_element(loginStates.begin(), loginStates.end(),
+                                  [&](const pair<const string, LoginState> &a, const pair<const string, LoginState> &b)
+                                  { return rank(a) < rank(b); });
+        loginStates.erase(victim);
+    }
+
+    // Reloads the map if the file changed since it was last read; call with lock held
+    bool refresh()
+    {
+        FileIdentity current = identify();
+        if (current.exists && current == loadedFrom)
+        {
+            return true;
+        }
+        MappedFile inFile;
+        if (!current.exists || !inFile.open(filename))
+        {
+            return false;
+        }
+        passwords.clear();
+        forEachLine(inFile.contents(),
+                    [&](string_view line, size_t)
+                    {
+                        string_view username = nextField(line, ',');
+                        string_view password = nextField(line, ',');
+                        // The first registration of a name owns it
+                        passwords.emplace(string(username), string(password));
+                    });
+        loadedFrom = current;
+        return true;
+    }
+
+public:
+    explicit CredentialDirectory(string filename) : filename(move(filename))
+    {
+    }
+
+    const string &getFilename() const
+    {
+        return filename;
+    }
+
+    // Appends a new user to the file; returns false if the name is taken or the file
+    // cannot be written
+    bool add(const string &username, const string &hashedPassword, string &error)
+    {
+        lock_guard<mutex> guard(lock);
+        refresh();
+        if (passwords.count(username))
+        {
+            error = "Username already exists.";
+            return false;
+        }
+
+        FileIdentity before = identify();
+        string line = username + "," + hashedPassword + "\n";
+        ofstream outFile(filename, ios::app);
+        if (!outFile.is_open())
+        {
+            error = "Unable to open " + filename + ".";
+            return false;
+        }
+        outFile << line;
+        outFile.close();
+        passwords.emplace(username, hashedPassword);
+
+        // Skip the reload if our line is the only change since the map was loaded
+        FileIdentity after = identify();
+        if (before == loadedFrom && after.inode == before.inode && after.size == before.size + line.size())
+        {
+            loadedFrom = after;
+        }
+        return true;
+    }
+
+    LoginResult login(const string &username, const string &hashedPassword, int &attemptsLeft,
+                      time_t &lockedUntil)
+    {
+        lock_guard<mutex> guard(lock);
+        if (!refresh())
+        {
+            return LOGIN_UNAVAILABLE;
+        }
+
+        time_t now = time(0);
+        if (!loginStates.count(username) && loginStates.size() >= MAX_LOGIN_STATES)
+        {
+            evictLoginState(now);
+        }
+        LoginState &state = loginStates[username];
+        state.lastAttempt = now;
+        if (now < state.lockedUntil)
+        {
+            lockedUntil = state.lockedUntil;
+            return LOGIN_STILL_LOCKED;
+        }
+
+        auto it = passwords.find(username);
+        if (it != passwords.end() && it->second == hashedPassword)
+        {
+            loginStates.erase(username);
+            return LOGIN_OK;
+        }
+
+        if (++state.failedAttempts >= MAX_FAILED_ATTEMPTS)
+        {
+            state.failedAttempts = 0;
+            state.lockedUntil = now + LOCK_TIME_MINUTES * 60;
+            lockedUntil = state.lockedUntil;
+            return LOGIN_LOCKED;
+        }
+        attemptsLeft = MAX_FAILED_ATTEMPTS - state.failedAttempts;
+        return LOGIN_FAILED;
+    }
+};
+
+CredentialDirectory adminCredentials("admin_credentials.csv");
+CredentialDirectory customerCredentials("customer_credentials.csv");
+
+// Shared by admin and customer registration; role is "Admin" or "Customer"
+bool registerUser(CredentialDirectory &directory, const string &role)
+{
+    string username, password;
+    cout << "\tRegister " << role << endl;
+    cout << "\tUsername: ";
+    cin.ignore();
+    getline(cin, username);
+    username = trim(username);
+    cout << "\tPassword: ";
+    getline(cin, password);
+    password = trim(password);
+
+    string hashedPassword = hashPassword(password);
+
+    string error;
+    if (username.empty() || username.find(',') != string::npos)
+    {
+        error = "Username must be non-empty and must not contain commas.";
+    }
+    if (!error.empty() || !directory.add(username, hashedPassword, error))
+    {
+        cout << "\tError: " << error << endl;
+        system("pause");
+        return false;
+    }
+
+    cout << "\t" << role << " registered successfully!" << endl;
+    system("pause"); // Pause after registration
+    return true;
+}
+
+// Shared by admin and customer login; role is "Admin" or "Customer"
+bool loginUser(CredentialDirectory &directory, const string &role)
+{
+    string username, password;
+
+    cout << "\tLogin " << role << endl;
+    cout << "\tUsername: ";
+    cin.ignore();
+    getline(cin, username);
+    username = trim(username);
+
+    cout << "\tPassword: ";
+    getline(cin, password);
+    password = trim(password);
+
+    string hashedPassword = hashPassword(password);
+
+    int attemptsLeft = 0;
+    time_t lockedUntil = 0;
+    CredentialDirectory::LoginResult result;
+    {
+        ScopedTimer timer(STAT_LOGIN);
+        result = directory.login(username, hashedPassword, attemptsLeft, lockedUntil);
+    }
+    if (result != CredentialDirectory::LOGIN_OK)
+    {
+        Stats::count(COUNTER_LOGIN_FAILURES);
+    }
+    switch (result)
+    {
+    case CredentialDirectory::LOGIN_OK:
+        cout << "\t" << role << " logged in successfully!" << endl;
+        return true;
+    case CredentialDirectory::LOGIN_FAILED:
+        cout << "\tInvalid username or password. You have " << attemptsLeft << " attempts left." << endl;
+        break;
+    case CredentialDirectory::LOGIN_LOCKED:
+        cout << "\tAccount locked for " << CredentialDirectory::LOCK_TIME_MINUTES
+             << " minutes due to too many failed login attempts." << endl;
+        break;
+    case CredentialDirectory::LOGIN_STILL_LOCKED:
+        cout << "\tAccount locked. Please wait " << (lockedUntil - time(0) + 59) / 60
+             << " minutes before trying again." << endl;
+        break;
+    case CredentialDirectory::LOGIN_UNAVAILABLE:
+        cout << "\tError: Unable to open " << directory.getFilename() << "." << endl;
+        break;
+    }
+    return false;
+}
+
+// Admin Registration
+bool registerAdmin()
+{
+    return registerUser(adminCredentials, "Admin");
+}
+
+// Admin Login
+bool loginAdmin()
+{
+    return loginUser(adminCredentials, "Admin");
+}
+
+// Customer Registration
+bool registerCustomer()
+{
+    return registerUser(customerCredentials, "Customer");
+}
+
+// Customer Login
+bool loginCustomer()
+{
+    return loginUser(customerCredentials, "Customer");
+}
+
+// Main Menu Functions
+void displayHeader(const string &title)
+{
+    system("cls");
+    cout << "\n\t************************************************************\n";
+    cout << "\t*                                                          *\n";
+    cout << "\t*               " << title << "                *\n";
+    cout << "\t*                                                          *\n";
+    cout << "\t************************************************************\n\n";
+}
+
+void salesReportMenu(Warehouse &warehouse)
+{
+    int choice;
+    do
+    {
+        displayHeader("Sales Report Menu");
+        cout << "1. Last Week\n";
+        cout << "2. Last Month\n";
+        cout << "3. Last Year\n";
+        cout << "4. Custom Date Range\n";
+        cout << "5. Back to Admin Menu\n";
+        cout << "Enter your choice: ";
+        cin >> choice;
+
+        WeeklyReport weeklyReport;
+        MonthlyReport monthlyReport;
+        YearlyReport yearlyReport;
+
+        switch (choice)
+        {
+        case 1:
+            weeklyReport.generateSalesReport(warehouse);
+            break;
+        case 2:
+            monthlyReport.generateSalesReport(warehouse);
+            break;
+        case 3:
+            yearlyReport.generateSalesReport(warehouse);
+            break;
+        case 4:
+        {
+            string fromText, toText;
+            int64_t fromDay, toDay;
+            cout << "Enter start date (YYYY-MM-DD): ";
+            cin >> fromText;
+            cout << "Enter end date (YYYY-MM-DD): ";
+            cin >> toText;
+            if (!parseDay(fromText, fromDay) || !parseDay(toText, toDay) || fromDay > toDay)
+            {
+                cout << "Invalid date range." << endl;
+                break;
+            }
+            DateRangeReport rangeReport(fromDay, toDay);
+            rangeReport.generateSalesReport(warehouse);
+            break;
+        }
+        case 5:
+            cout << "Returning to Admin Menu..." << endl;
+            break;
+        default:
+            cout << "Invalid choice. Please try again." << endl;
+        }
+        system("pause"); // Pause after sales report menu
+    } while (choice != 5);
+}
+
+// Admin menu
+void adminMenu(Warehouse &warehouse)
+{
+    int choice;
+    do
+    {
+        displayHeader("Admin Menu");
+        cout << "1. Add Product\n";
+        cout << "2. Update Product\n";
+        cout << "3. Remove Product\n";
+        cout << "4. View Inventory\n";
+        cout << "5. View Orders\n";
+        cout << "6. Generate Sales Report\n"; // New option for sales report
+        cout << "7. Logout\n";
+        cout << "Enter your choice: ";
+        cin >> choice;
+
+        switch (choice)
+        {
+        case 1:
+        {
+            string id, name, priceText;
+            int qty;
+            int64_t price;
+            cout << "Enter Product ID: ";
+            cin >> id;
+            cout << "Enter Name: ";
+            cin >> name;
+            cout << "Enter Quantity: ";
+            cin >> qty;
+            cout << "Enter Price: ";
+            cin >> priceText;
+            if (qty < 0)
+            {
+                cout << "Invalid quantity." << endl;
+            }
+            else if (!parseCents(priceText, price) || price < 0)
+            {
+                cout << "Invalid price." << endl;
+            }
+            else if (warehouse.addProduct(Product(id, name, qty, price)))
+            {
+                cout << "Product added successfully!" << endl;
+            }
+            else
+            {
+                cout << "A product with that ID or name already exists." << endl;
+            }
+            system("pause"); // Pause after adding a product
+            break;
+        }
+        case 2:
+        {
+            string id;
+            cout << "Enter Product ID to Update: ";
+            cin >> id;
+            warehouse.updateProduct(id);
+            break;
+        }
+        case 3:
+        {
+            string id;
+            cout << "Enter Product ID to Remove: ";
+            cin >> id;
+            warehouse.deleteProduct(id);
+            system("pause"); // Pause after removing a product
+            break;
         }
         case 4:
             warehouse.viewInventory();
@@ -1013,56 +6448,1828 @@ void adminMenu(Warehouse &warehouse)
             break;
         case 6:
         {
-            salesReportMenu();
-            break;
+            salesReportMenu(warehouse);
+            break;
+        }
+        case 7:
+            cout << "Logging out..." << endl;
+            break;
+        default:
+            cout << "Invalid choice. Please try again." << endl;
+        }
+    } while (choice != 7);
+}
+
+void customerMenu(Warehouse &warehouse)
+{
+    int choice;
+    do
+    {
+        displayHeader("Customer Menu");
+        cout << "1. View Inventory\n";
+        cout << "2. Place Order\n";
+        cout << "3. Logout\n";
+        cout << "Enter your choice: ";
+        cin >> choice;
+
+        switch (choice)
+        {
+        case 1:
+            warehouse.viewInventory();
+            break;
+        case 2:
+        {
+            warehouse.addOrder();
+            warehouse.viewInventory();
+            break;
+        }
+        case 3:
+            cout << "Logging out..." << endl;
+            break;
+        default:
+            cout << "Invalid choice. Please try again." << endl;
+        }
+    } while (choice != 3);
+}
+
+// Line-oriented command protocol over a Warehouse, for scripts and driver processes.
+// Each request is one line of whitespace-separated words; a word containing spaces is
+// written in double quotes. Every request gets one response line starting with "OK" or
+// "ERR"; REPORT and TOP are followed by one extra line per product.
+//
+//   ORDER <name> <qty> [<name> <qty> ...]   OK <orderID>
+//   STOCK <id|name>                         OK <id> <qty> <price> <name>
+//   REPORT <YYYY-MM-DD> <YYYY-MM-DD>        OK <orders> <products> <revenue>, then
+//                                           "<qty> <revenue> <name>" lines
+//   ADD <id> <name> <qty> <price>           OK
+//   REMOVE <id> | SETQTY <id> <qty> | SETPRICE <id> <price> | RENAME <id> <name>
+//   TOP [k]                                 OK <n>, then "<count> <error> <name>" lines
+//   STATS                                   OK <statistics as JSON>
+//   HELP | QUIT
+//
+// REPORT covers orders from the start of the first date up to, but not including, the
+// second date.
+class CommandProcessor
+{
+public:
+    enum Outcome
+    {
+        COMMAND_DONE,
+        COMMAND_NEEDS_SYNC, // Placed an order that is journaled but not yet durable
+        COMMAND_QUIT
+    };
+
+private:
+    Warehouse &warehouse;
+
+    static bool tokenize(string_view line, vector<string> &words)
+    {
+        size_t pos = 0;
+        while (true)
+        {
+            pos = line.find_first_not_of(" \t", pos);
+            if (pos == string_view::npos)
+            {
+                return true;
+            }
+            if (line[pos] == '"')
+            {
+                size_t end = line.find('"', pos + 1);
+                if (end == string_view::npos)
+                {
+                    return false;
+                }
+                words.emplace_back(line.substr(pos + 1, end - pos - 1));
+                pos = end + 1;
+            }
+            else
+            {
+                size_t end = min(line.find_first_of(" \t", pos), line.size());
+                words.emplace_back(line.substr(pos, end - pos));
+                pos = end;
+            }
+        }
+    }
+
+    // Names and IDs end up in comma- and pipe-separated data files
+    static bool validField(const string &text)
+    {
+        return !text.empty() && text.find_first_of(",|\t\r\n") == string::npos;
+    }
+
+    Outcome order(const vector<string> &words, string &response)
+    {
+        if (words.size() < 3 || words.size() % 2 == 0)
+        {
+            response = "ERR usage: ORDER <name> <qty> [<name> <qty> ...]\n";
+            return COMMAND_DONE;
+        }
+        Order request("", time(0));
+        for (size_t i = 1; i < words.size(); i += 2)
+        {
+            int quantity;
+            if (!parseNumber(words[i + 1], quantity))
+            {
+                response = "ERR invalid quantity for " + words[i] + "\n";
+                return COMMAND_DONE;
+            }
+            request.addProduct(words[i], quantity);
+        }
+        string error;
+        optional<string> orderID = warehouse.placeOrder(request, error);
+        if (!orderID)
+        {
+            response = "ERR " + error + "\n";
+            return COMMAND_DONE;
+        }
+        response = "OK " + *orderID + "\n";
+        return COMMAND_NEEDS_SYNC;
+    }
+
+    void stock(const vector<string> &words, string &response)
+    {
+        if (words.size() != 2)
+        {
+            response = "ERR usage: STOCK <id|name>\n";
+            return;
+        }
+        vector<Product> products = warehouse.searchProducts(words[1]);
+        if (products.empty())
+        {
+            response = "ERR product not found: " + words[1] + "\n";
+            return;
+        }
+        const Product &product = products.front();
+        response = "OK " + product.getProductID() + " " + to_string(product.getQuantity()) + " " +
+                   formatCents(product.getPrice()) + " " + product.getName() + "\n";
+    }
+
+    void report(const vector<string> &words, string &response)
+    {
+        int64_t startDay, endDay;
+        if (words.size() != 3 || !parseDay(words[1], startDay) || !parseDay(words[2], endDay))
+        {
+            response = "ERR usage: REPORT <YYYY-MM-DD> <YYYY-MM-DD>\n";
+            return;
+        }
+        if (warehouse.isTrackingApproximateSales())
+        {
+            response = "ERR exact sales are not kept (started with --approximate)\n";
+            return;
+        }
+        size_t orderCount = 0;
+        vector<Warehouse::ProductSales> sales = warehouse.getSalesBetween(startDay, endDay - 1, orderCount);
+        int64_t revenue = 0;
+        string lines;
+        for (const auto &sale : sales)
+        {
+            revenue += sale.revenue;
+            lines += to_string(sale.units) + " " + formatCents(sale.revenue) + " " + sale.name + "\n";
+        }
+        response = "OK " + to_string(orderCount) + " " + to_string(sales.size()) + " " + formatCents(revenue) + "\n" +
+                   lines;
+    }
+
+    void topSellers(const vector<string> &words, string &response)
+    {
+        size_t k = SalesReport::topCount;
+        if (words.size() > 2 || (words.size() == 2 && !parseNumber(words[1], k)))
+        {
+            response = "ERR usage: TOP [k]\n";
+            return;
+        }
+        if (!warehouse.isTrackingTopSellers())
+        {
+            response = "ERR top seller tracking is off (start with --track-top)\n";
+            return;
+        }
+        vector<SpaceSavingSketch::Entry> entries = warehouse.getTopSellers(k);
+        response = "OK " + to_string(entries.size()) + "\n";
+        for (const auto &entry : entries)
+        {
+            response += to_string(entry.count) + " " + to_string(entry.error) + " " + entry.item + "\n";
+        }
+    }
+
+    void changeProduct(const vector<string> &words, string &response)
+    {
+        const string &command = words[0];
+        size_t expected = command == "ADD" ? 5 : command == "REMOVE" ? 2 : 3;
+        if (words.size() != expected || !validField(words[1]))
+        {
+            response = "ERR usage: " + command +
+                       (command == "ADD"        ? " <id> <name> <qty> <price>"
+                        : command == "REMOVE"   ? " <id>"
+                        : command == "SETQTY"   ? " <id> <qty>"
+                        : command == "SETPRICE" ? " <id> <price>"
+                                                : " <id> <name>") +
+                       "\n";
+            return;
+        }
+
+        const string &id = words[1];
+        int quantity;
+        int64_t price;
+        string error;
+        bool changed;
+        if (command == "ADD")
+        {
+            if (!validField(words[2]) || !parseNumber(words[3], quantity) || quantity < 0 ||
+                !parseCents(words[4], price) || price < 0)
+            {
+                response = "ERR invalid product fields\n";
+                return;
+            }
+            changed = warehouse.addProduct(Product(id, words[2], quantity, price));
+            error = "product ID or name already in use";
+        }
+        else if (command == "REMOVE")
+        {
+            changed = warehouse.removeProduct(id);
+            error = "product ID not found";
+        }
+        else if (command == "SETQTY")
+        {
+            if (!parseNumber(words[2], quantity) || quantity < 0)
+            {
+                response = "ERR invalid quantity\n";
+                return;
+            }
+            changed = warehouse.setProductQuantity(id, quantity);
+            error = "product ID not found";
+        }
+        else if (command == "SETPRICE")
+        {
+            if (!parseCents(words[2], price) || price < 0)
+            {
+                response = "ERR invalid price\n";
+                return;
+            }
+            changed = warehouse.setProductPrice(id, price);
+            error = "product ID not found";
+        }
+        else
+        {
+            if (!validField(words[2]))
+            {
+                response = "ERR invalid product name\n";
+                return;
+            }
+            changed = warehouse.renameProduct(id, words[2], error);
+        }
+        response = changed ? "OK\n" : "ERR " + error + "\n";
+    }
+
+public:
+    explicit CommandProcessor(Warehouse &warehouse) : warehouse(warehouse)
+    {
+    }
+
+    // Lines that follow firstLine in the reply to request: REPORT and TOP list their rows
+    // after a count, every other reply is one line
+    static size_t followingLines(string_view request, string_view firstLine)
+    {
+        vector<string> words, fields;
+        if (!tokenize(request, words) || words.empty() || !tokenize(firstLine, fields) || fields[0] != "OK")
+        {
+            return 0;
+        }
+        string command = words[0];
+        transform(command.begin(), command.end(), command.begin(), [](unsigned char c) { return toupper(c); });
+        size_t count = 0;
+        size_t field = command == "REPORT" ? 2 : command == "TOP" ? 1 : 0;
+        if (field == 0 || fields.size() <= field || !parseNumber(fields[field], count))
+        {
+            return 0;
+        }
+        return count;
+    }
+
+    // Runs one request line and sets response to its reply (empty for a blank line)
+    Outcome execute(string_view line, string &response)
+    {
+        vector<string> words;
+        response.clear();
+        if (!tokenize(line, words))
+        {
+            response = "ERR unterminated quote\n";
+            return COMMAND_DONE;
+        }
+        if (words.empty())
+        {
+            return COMMAND_DONE;
+        }
+        string &command = words[0];
+        transform(command.begin(), command.end(), command.begin(), [](unsigned char c) { return toupper(c); });
+
+        if (command == "ORDER")
+        {
+            return order(words, response);
+        }
+        if (command == "STOCK")
+        {
+            stock(words, response);
+        }
+        else if (command == "REPORT")
+        {
+            report(words, response);
+        }
+        else if (command == "ADD" || command == "REMOVE" || command == "SETQTY" || command == "SETPRICE" ||
+                 command == "RENAME")
+        {
+            changeProduct(words, response);
+        }
+        else if (command == "TOP")
+        {
+            topSellers(words, response);
+        }
+        else if (command == "STATS")
+        {
+            ostringstream json;
+            Stats::collect().printJSON(json);
+            response = "OK " + json.str();
+        }
+        else if (command == "HELP")
+        {
+            response = "OK ORDER STOCK REPORT TOP ADD REMOVE SETQTY SETPRICE RENAME STATS HELP QUIT\n";
+        }
+        else if (command == "QUIT")
+        {
+            response = "OK bye\n";
+            return COMMAND_QUIT;
+        }
+        else
+        {
+            response = "ERR unknown command: " + command + "\n";
+        }
+        return COMMAND_DONE;
+    }
+};
+
+// Syncs the journal before a batch of replies goes out. If the orders the batch
+// acknowledges cannot be made durable, their "OK <id>" replies (starting at the given
+// offsets) are replaced by errors; the orders stay placed and reach the data files at
+// the next successful compaction.
+void syncBeforeReplying(Warehouse &warehouse, string &replies, vector<size_t> &acknowledgements)
+{
+    if (acknowledgements.empty() || warehouse.syncJournal())
+    {
+        acknowledgements.clear();
+        return;
+    }
+    for (auto it = acknowledgements.rbegin(); it != acknowledgements.rend(); ++it)
+    {
+        size_t end = replies.find('\n', *it);
+        string orderID = replies.substr(*it + 3, end - *it - 3);
+        replies.replace(*it, end - *it, "ERR order " + orderID + " is not durable: journal write failed");
+    }
+    acknowledgements.clear();
+}
+
+// Command Mode: answers CommandProcessor requests from in until QUIT or end of input.
+// Replies are held back while more requests are already buffered, then the journal is
+// synced once and the whole batch is written, so a pipelining driver gets group commit
+// and one write per batch.
+int serveCommands(Warehouse &warehouse, istream &in, ostream &out)
+{
+    CommandProcessor processor(warehouse);
+    string line, response, replies;
+    vector<size_t> acknowledgements; // Offsets of order acknowledgements awaiting a sync
+    while (getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        CommandProcessor::Outcome outcome = processor.execute(line, response);
+        if (outcome == CommandProcessor::COMMAND_NEEDS_SYNC)
+        {
+            acknowledgements.push_back(replies.size());
+        }
+        replies += response;
+        if (outcome == CommandProcessor::COMMAND_QUIT)
+        {
+            break;
+        }
+        if (in.rdbuf()->in_avail() <= 0 || replies.size() >= (1 << 16))
+        {
+            syncBeforeReplying(warehouse, replies, acknowledgements);
+            out << replies << flush;
+            replies.clear();
+        }
+    }
+    syncBeforeReplying(warehouse, replies, acknowledgements);
+    out << replies << flush;
+    return 0;
+}
+
+#ifndef _WIN32
+// Resolves "[host:]port" to an IPv4 address; the host defaults to 127.0.0.1, and an empty
+// host (":port") means every interface
+bool parseEndpoint(const string &text, sockaddr_in &address, string &error)
+{
+    size_t colon = text.rfind(':');
+    string host = colon == string::npos ? "127.0.0.1" : text.substr(0, colon);
+    string portText = colon == string::npos ? text : text.substr(colon + 1);
+    uint16_t port;
+    if (!parseNumber(portText, port))
+    {
+        error = "invalid port: " + portText;
+        return false;
+    }
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *found = nullptr;
+    int status = getaddrinfo(host.empty() ? "0.0.0.0" : host.c_str(), nullptr, &hints, &found);
+    if (status != 0)
+    {
+        error = host + ": " + gai_strerror(status);
+        return false;
+    }
+    address = *reinterpret_cast<sockaddr_in *>(found->ai_addr);
+    address.sin_port = htons(port);
+    freeaddrinfo(found);
+    return true;
+}
+#endif
+
+#ifdef __linux__
+// Network Mode: answers CommandProcessor requests from TCP clients, one request per line,
+// with each connection's replies in the order of its requests. One thread runs a
+// non-blocking epoll loop that accepts connections, reads requests and writes replies.
+// The requests a connection has buffered go to the worker pool as one batch, which syncs
+// the journal once before its replies are sent. A connection has at most one batch in
+// flight, so its replies stay in order while different connections run in parallel.
+class TcpServer
+{
+private:
+    struct Connection
+    {
+        int fd;
+        string input;             // Received bytes not yet handed to the pool
+        string output;            // Replies not yet sent
+        uint32_t events = 0;      // Events the loop is watching for; 0 when out of epoll
+        bool busy = false;        // A batch of its requests is on the pool
+        bool quit = false;        // Sent QUIT, or was told its request is too long
+        bool tooLong = false;     // Sent a request too long to take; answered after the ones before it
+        bool peerClosed = false;  // The client will send nothing more
+        bool dead = false;        // Sending failed; closed once no batch is in flight
+    };
+
+    // Replies to one batch of requests, handed back to the event loop
+    struct Batch
+    {
+        int fd;
+        string replies;
+        bool quit;
+    };
+
+    static const size_t MAX_REQUEST_BYTES = 1 << 16;  // Longer requests get an error and close the connection
+    static const size_t MAX_BUFFERED_BYTES = 1 << 20; // Stop reading while this much is queued
+    static const int MAX_EVENTS = 256;
+    static const int STOP_CHECK_MS = 500;
+
+    Warehouse &warehouse;
+    CommandProcessor processor;
+    WorkStealingPool pool;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd the workers signal when a batch is finished
+    unordered_map<int, unique_ptr<Connection>> connections; // Touched by the event loop only
+    mutex finishedLock;
+    vector<Batch> finished;
+
+    static atomic<bool> stopRequested;
+
+    static void requestStop(int)
+    {
+        stopRequested = true;
+    }
+
+    void watch(int fd, uint32_t events, int operation)
+    {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, operation, fd, &event);
+    }
+
+    void acceptConnections()
+    {
+        while (true)
+        {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                {
+                    cerr << "accept: " << strerror(errno) << endl;
+                }
+                return;
+            }
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            auto connection = make_unique<Connection>();
+            connection->fd = fd;
+            connection->events = EPOLLIN | EPOLLRDHUP;
+            watch(fd, connection->events, EPOLL_CTL_ADD);
+            connections[fd] = move(connection);
+        }
+    }
+
+    // Reads what the client sent, up to the buffering limit. Nothing is read past a request
+    // too long to take, which is dropped; the complete ones before it are still answered.
+    void receive(Connection &connection)
+    {
+        char buffer[1 << 14];
+        while (!connection.peerClosed && !connection.tooLong && connection.input.size() < MAX_BUFFERED_BYTES)
+        {
+            ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (received > 0)
+            {
+                connection.input.append(buffer, received);
+            }
+            else if (received < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                connection.peerClosed = received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+                break;
+            }
+        }
+        size_t lineStart = connection.input.rfind('\n');
+        lineStart = lineStart == string::npos ? 0 : lineStart + 1;
+        if (connection.input.size() - lineStart > MAX_REQUEST_BYTES)
+        {
+            connection.input.resize(lineStart);
+            connection.tooLong = true;
+        }
+    }
+
+    // Runs on a pool thread
+    void runBatch(int fd, const string &requests)
+    {
+        Batch batch{fd, "", false};
+        string_view rest = requests;
+        string response;
+        vector<size_t> acknowledgements;
+        while (!rest.empty() && !batch.quit)
+        {
+            string_view line = nextField(rest, '\n');
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+            CommandProcessor::Outcome outcome = processor.execute(line, response);
+            if (outcome == CommandProcessor::COMMAND_NEEDS_SYNC)
+            {
+                acknowledgements.push_back(batch.replies.size());
+            }
+            batch.replies += response;
+            batch.quit = outcome == CommandProcessor::COMMAND_QUIT;
+        }
+        syncBeforeReplying(warehouse, batch.replies, acknowledgements);
+        {
+            lock_guard<mutex> guard(finishedLock);
+            finished.push_back(move(batch));
+        }
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) < 0)
+        {
+            cerr << "Unable to wake the event loop: " << strerror(errno) << endl;
+        }
+    }
+
+    // Hands every complete request the connection has buffered to the pool as one batch.
+    // Once those before a request too long to take are answered, the error follows.
+    void dispatch(Connection &connection)
+    {
+        if (connection.busy || connection.quit || connection.output.size() >= MAX_BUFFERED_BYTES)
+        {
+            return;
+        }
+        size_t end = connection.input.rfind('\n');
+        if (end == string::npos)
+        {
+            if (connection.tooLong)
+            {
+                connection.output += "ERR request too long\n";
+                connection.quit = true;
+            }
+            return;
+        }
+        string requests = connection.input.substr(0, end + 1);
+        connection.input.erase(0, end + 1);
+        connection.busy = true;
+        int fd = connection.fd;
+        pool.submit([this, fd, requests] { runBatch(fd, requests); }, static_cast<size_t>(fd));
+    }
+
+    // Sends as much of the pending replies as the socket takes; false if the client is gone
+    bool flush(Connection &connection)
+    {
+        size_t sentTotal = 0;
+        while (sentTotal < connection.output.size())
+        {
+            ssize_t sent = send(connection.fd, connection.output.data() + sentTotal,
+                                connection.output.size() - sentTotal, MSG_NOSIGNAL);
+            if (sent >= 0)
+            {
+                sentTotal += sent;
+            }
+            else if (errno != EINTR)
+            {
+                connection.output.erase(0, sentTotal);
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+        }
+        connection.output.clear();
+        return true;
+    }
+
+    // Moves a connection along after anything happened to it: dispatches its requests,
+    // sends its replies, closes it once it is done and watches for what it waits on next
+    void update(Connection &connection)
+    {
+        if (!connection.dead)
+        {
+            dispatch(connection);
+            connection.dead = !flush(connection);
+        }
+        bool done = !connection.busy && connection.output.empty() &&
+                    (connection.quit || (connection.peerClosed && connection.input.find('\n') == string::npos));
+        if (connection.dead || done)
+        {
+            if (connection.events != 0)
+            {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+                connection.events = 0;
+            }
+            // A connection with a batch on the pool is closed when the batch comes back,
+            // so its descriptor cannot go to a new connection the replies would reach
+            if (!connection.busy)
+            {
+                ::close(connection.fd);
+                connections.erase(connection.fd);
+            }
+            return;
+        }
+        // Level-triggered, so a hangup already seen would be reported again and again:
+        // EPOLLRDHUP is watched only while reading. A connection waiting only on its batch
+        // watches nothing and leaves epoll, which reports EPOLLHUP whatever the mask.
+        uint32_t events = 0;
+        if (!connection.peerClosed && !connection.quit && !connection.tooLong &&
+            connection.input.size() < MAX_BUFFERED_BYTES &&
+            connection.output.size() < MAX_BUFFERED_BYTES)
+        {
+            events |= EPOLLIN | EPOLLRDHUP;
+        }
+        if (!connection.output.empty())
+        {
+            events |= EPOLLOUT;
+        }
+        if (events != connection.events)
+        {
+            watch(connection.fd, events,
+                  connection.events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+            connection.events = events;
+        }
+    }
+
+    void collectFinished()
+    {
+        uint64_t count;
+        if (read(wakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        {
+            cerr << "Unable to read the event loop's wakeups: " << strerror(errno) << endl;
+        }
+        vector<Batch> batches;
+        {
+            lock_guard<mutex> guard(finishedLock);
+            batches.swap(finished);
+        }
+        for (auto &batch : batches)
+        {
+            // A busy connection is never closed, so it is still there
+            auto it = connections.find(batch.fd);
+            if (it == connections.end())
+            {
+                continue;
+            }
+            Connection &connection = *it->second;
+            connection.busy = false;
+            if (!connection.dead)
+            {
+                connection.output += batch.replies;
+                connection.quit = connection.quit || batch.quit;
+            }
+            update(connection);
+        }
+    }
+
+public:
+    TcpServer(Warehouse &warehouse, size_t threadCount)
+        : warehouse(warehouse), processor(warehouse), pool(threadCount)
+    {
+    }
+
+    ~TcpServer()
+    {
+        pool.waitIdle();
+        for (auto &connection : connections)
+        {
+            ::close(connection.first);
+        }
+        for (int fd : {listenFd, epollFd, wakeFd})
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+    // Serves until SIGINT or SIGTERM; false if the address cannot be listened on
+    bool run(const sockaddr_in &address)
+    {
+        int on = 1;
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0 || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+            bind(listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+            listen(listenFd, SOMAXCONN) != 0)
+        {
+            cerr << "Unable to listen: " << strerror(errno) << endl;
+            return false;
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0)
+        {
+            cerr << "Unable to start the event loop: " << strerror(errno) << endl;
+            return false;
+        }
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+        watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+
+        // Without SA_RESTART the signal also cuts epoll_wait short
+        struct sigaction action = {};
+        action.sa_handler = requestStop;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        sockaddr_in bound = {};
+        socklen_t boundLength = sizeof(bound);
+        getsockname(listenFd, reinterpret_cast<sockaddr *>(&bound), &boundLength);
+        char host[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &bound.sin_addr, host, sizeof(host));
+        cout << "Listening on " << host << ":" << ntohs(bound.sin_port) << " with " << pool.size()
+             << " worker thread(s)" << endl;
+
+        epoll_event events[MAX_EVENTS];
+        while (!stopRequested)
+        {
+            // Wakes now and then in case a stop request landed just before the wait
+            int ready = epoll_wait(epollFd, events, MAX_EVENTS, STOP_CHECK_MS);
+            for (int i = 0; i < ready; ++i)
+            {
+                int fd = events[i].data.fd;
+                if (fd == listenFd)
+                {
+                    acceptConnections();
+                    continue;
+                }
+                if (fd == wakeFd)
+                {
+                    collectFinished();
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end() || it->second->dead)
+                {
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                {
+                    receive(*it->second);
+                }
+                update(*it->second);
+            }
+        }
+        cout << "Stopping; waiting for requests in progress" << endl;
+        return true;
+    }
+};
+
+atomic<bool> TcpServer::stopRequested{false};
+#endif
+
+const size_t DEFAULT_LISTEN_THREADS = 4;
+
+// Serves CommandProcessor requests on a TCP port until interrupted
+int serveTcp(Warehouse &warehouse, const string &endpoint, size_t threadCount)
+{
+#ifdef __linux__
+    sockaddr_in address;
+    string error;
+    if (!parseEndpoint(endpoint, address, error))
+    {
+        cerr << "--listen: " << error << endl;
+        return 1;
+    }
+    TcpServer server(warehouse, threadCount);
+    return server.run(address) ? 0 : 1;
+#else
+    (void)warehouse;
+    (void)endpoint;
+    (void)threadCount;
+    cerr << "--listen needs Linux (epoll)." << endl;
+    return 1;
+#endif
+}
+
+// Load Generator: drives a --listen server from connectionCount clients, each with one
+// request in flight, and prints requests per second and the latency distribution as a
+// JSON line. Requests are taken in turn from requestsFile, or else are a mix of STOCK
+// lookups and single-unit ORDERs (one in ten) of the products --generate writes.
+int runLoadTest(const string &endpoint, const string &requestsFile, size_t connectionCount, size_t requestCount,
+                size_t skuCount)
+{
+#ifdef _WIN32
+    (void)endpoint;
+    (void)requestsFile;
+    (void)connectionCount;
+    (void)requestCount;
+    (void)skuCount;
+    cerr << "--load-test is not supported on this platform." << endl;
+    return 1;
+#else
+    sockaddr_in address;
+    string error;
+    if (!parseEndpoint(endpoint, address, error))
+    {
+        cerr << "--load-test: " << error << endl;
+        return 1;
+    }
+    vector<string> requests;
+    if (!requestsFile.empty())
+    {
+        ifstream inFile(requestsFile);
+        string line;
+        while (getline(inFile, line))
+        {
+            if (!trim(line).empty())
+            {
+                requests.push_back(line + "\n");
+            }
+        }
+        if (requests.empty())
+        {
+            cerr << "No requests in " << requestsFile << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        mt19937_64 random(42);
+        uniform_int_distribution<size_t> skuDist(0, max<size_t>(1, skuCount) - 1);
+        for (int i = 0; i < 4096; ++i)
+        {
+            string item = "Item" + to_string(skuDist(random));
+            requests.push_back(i % 10 == 0 ? "ORDER " + item + " 1\n" : "STOCK " + item + "\n");
+        }
+    }
+
+    connectionCount = max<size_t>(1, connectionCount);
+    vector<vector<double>> latencies(connectionCount); // Microseconds, per connection
+    atomic<size_t> rejected{0};
+    atomic<bool> failed{false};
+    auto client = [&](size_t self)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int on = 1;
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            cerr << "Unable to connect to " << endpoint << ": " << strerror(errno) << endl;
+            failed = true;
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            return;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        string buffer;
+        char chunk[1 << 14];
+        auto readLine = [&](string &line)
+        {
+            size_t end;
+            while ((end = buffer.find('\n')) == string::npos)
+            {
+                ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+                if (received <= 0)
+                {
+                    return false;
+                }
+                buffer.append(chunk, received);
+            }
+            line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            return true;
+        };
+        string reply, row;
+        for (size_t i = self; i < requestCount && !failed; i += connectionCount)
+        {
+            const string &request = requests[i % requests.size()];
+            auto start = chrono::steady_clock::now();
+            if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size()) ||
+                !readLine(reply))
+            {
+                cerr << "Connection to " << endpoint << " lost" << endl;
+                failed = true;
+                break;
+            }
+            for (size_t rows = CommandProcessor::followingLines(request, reply); rows > 0; --rows)
+            {
+                if (!readLine(row))
+                {
+                    failed = true;
+                    break;
+                }
+            }
+            latencies[self].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            if (reply.compare(0, 3, "ERR") == 0)
+            {
+                rejected++;
+            }
+        }
+        ::close(fd);
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> clients;
+    for (size_t i = 0; i < connectionCount; ++i)
+    {
+        clients.emplace_back(client, i);
+    }
+    for (auto &worker : clients)
+    {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (failed)
+    {
+        return 1;
+    }
+
+    vector<double> all;
+    for (const auto &connectionLatencies : latencies)
+    {
+        all.insert(all.end(), connectionLatencies.begin(), connectionLatencies.end());
+    }
+    sort(all.begin(), all.end());
+    auto percentile = [&](double fraction)
+    { return all.empty() ? 0 : all[min(all.size() - 1, size_t(fraction * all.size()))]; };
+    cout << fixed << setprecision(3) << "{\"benchmark\":\"tcp_load\",\"connections\":" << connectionCount
+         << ",\"ops\":" << all.size() << ",\"rejected\":" << rejected << ",\"seconds\":" << seconds
+         << ",\"ops_per_sec\":" << (seconds > 0 ? all.size() / seconds : 0) << ",\"p50_us\":" << percentile(0.50)
+         << ",\"p99_us\":" << percentile(0.99) << ",\"p999_us\":" << percentile(0.999)
+         << ",\"max_us\":" << (all.empty() ? 0 : all.back()) << "}" << endl;
+    return 0;
+#endif
+}
+
+// Bulk Order Ingestion: reads orders either in the orders.txt format
+// ("Ref,Date|Name,Quantity|...") or as CSV lines "Ref,Name,Quantity", where consecutive
+// lines with the same Ref form one order. Each order is placed in full or rejected, and
+// one result line per order is written to the output file. With threadCount > 0 orders
+// are placed on a work-stealing pool and results are written in completion order.
+int ingestOrders(Warehouse &warehouse, const string &inputFile, const string &outputFile, size_t threadCount = 0)
+{
+    ofstream outFile(outputFile);
+    if (!outFile.is_open())
+    {
+        cerr << "Unable to open " << outputFile << " for writing." << endl;
+        return 1;
+    }
+
+    size_t accepted = 0, rejected = 0;
+    mutex resultLock;
+    string error;
+    string pendingRef;
+    optional<Order> pendingOrder;
+    unique_ptr<WorkStealingPool> pool;
+    if (threadCount > 0)
+    {
+        pool = make_unique<WorkStealingPool>(threadCount);
+    }
+
+    auto writeResult = [&](const string &ref, const optional<string> &orderID, const string &reason)
+    {
+        lock_guard<mutex> resultGuard(resultLock);
+        if (orderID)
+        {
+            outFile << "ACCEPTED " << ref << " " << *orderID << "\n";
+            accepted++;
+        }
+        else
+        {
+            outFile << "REJECTED " << ref << " " << reason << "\n";
+            rejected++;
+        }
+    };
+
+    auto placePending = [&]()
+    {
+        if (!pendingOrder)
+        {
+            return;
+        }
+        if (pool)
+        {
+            warehouse.placeOrderAsync(*pool, *pendingOrder,
+                                      [&writeResult, ref = pendingRef](const optional<string> &orderID,
+                                                                       const string &reason)
+                                      { writeResult(ref, orderID, reason); });
+        }
+        else
+        {
+            optional<string> orderID = warehouse.placeOrder(*pendingOrder, error);
+            writeResult(pendingRef, orderID, error);
+        }
+        pendingOrder.reset();
+    };
+
+    auto ingestLine = [&](string_view line, size_t lineNumber)
+    {
+        if (line.find('|') != string_view::npos)
+        {
+            placePending();
+            optional<Order> order = Order::fromFileFormat(line, error);
+            if (!order)
+            {
+                writeResult("line " + to_string(lineNumber), nullopt, error);
+                return;
+            }
+            pendingRef = order->getOrderID();
+            pendingOrder = order;
+            placePending();
+            return;
+        }
+
+        string_view ref = nextField(line, ',');
+        string_view name = nextField(line, ',');
+        int quantity;
+        if (ref.empty() || name.empty() || !parseNumber(line, quantity))
+        {
+            placePending();
+            writeResult("line " + to_string(lineNumber), nullopt, "expected Ref,Name,Quantity");
+            return;
+        }
+        if (!pendingOrder || pendingRef != ref)
+        {
+            placePending();
+            pendingRef = string(ref);
+            pendingOrder = Order(pendingRef, time(0));
+        }
+        pendingOrder->addProduct(string(name), quantity);
+    };
+
+    auto startTime = chrono::steady_clock::now();
+    if (inputFile == "-")
+    {
+        string line;
+        size_t lineNumber = 0;
+        while (getline(cin, line))
+        {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (!line.empty())
+            {
+                ingestLine(line, lineNumber);
+            }
+        }
+    }
+    else
+    {
+        MappedFile inFile;
+        if (!inFile.open(inputFile))
+        {
+            cerr << "Unable to open " << inputFile << " for reading." << endl;
+            return 1;
+        }
+        forEachLine(inFile.contents(), ingestLine);
+    }
+    placePending();
+    if (pool)
+    {
+        pool->waitIdle();
+    }
+    bool durable = warehouse.syncJournal();
+    outFile.close();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    size_t total = accepted + rejected;
+    cout << "Ingested " << total << " orders (" << accepted << " accepted, " << rejected << " rejected) in "
+         << fixed << setprecision(3) << seconds << " s";
+    if (seconds > 0)
+    {
+        cout << ", " << setprecision(0) << (total / seconds) << " orders/s";
+    }
+    cout << "\nResults written to " << outputFile << endl;
+    if (!durable)
+    {
+        cerr << "The accepted orders could not be saved; they are lost." << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Stock Reservation Stress Test: several threads place random multi-line orders against
+// a small catalog, with half the lines aimed at one hot SKU. Passes if no stock went
+// negative and every SKU's final stock equals its initial stock minus what was accepted.
+int runStressTest(int threadCount)
+{
+    const int SKU_COUNT = 64;
+    const int INITIAL_STOCK = 20000;
+    const int64_t PRICE_CENTS = 100;
+    const int ORDERS_PER_THREAD = 100000;
+
+    Warehouse warehouse;
+    for (int i = 0; i < SKU_COUNT; ++i)
+    {
+        warehouse.addProduct(Product("S" + to_string(i), "Sku" + to_string(i), INITIAL_STOCK, PRICE_CENTS));
+    }
+
+    vector<vector<long long>> acceptedPerThread(threadCount, vector<long long>(SKU_COUNT, 0));
+    vector<size_t> acceptedOrders(threadCount, 0);
+    atomic<bool> sawNegative{false};
+    vector<thread> threads;
+    auto startTime = chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back(
+            [&, t]()
+            {
+                mt19937 random(12345 + t);
+                uniform_int_distribution<int> skuDist(0, SKU_COUNT - 1), lineDist(1, 3), qtyDist(1, 5);
+                string error;
+                for (int n = 0; n < ORDERS_PER_THREAD; ++n)
+                {
+                    Order request("stress", 0);
+                    int lineCount = lineDist(random);
+                    for (int line = 0; line < lineCount; ++line)
+                    {
+                        int sku = (random() & 1) ? 0 : skuDist(random);
+                        request.addProduct("Sku" + to_string(sku), qtyDist(random));
+                    }
+                    if (warehouse.placeOrder(request, error))
+                    {
+                        const auto &names = request.getOrderProductNames();
+                        const auto &quantities = request.getQuantities();
+                        for (size_t i = 0; i < names.size(); ++i)
+                        {
+                            acceptedPerThread[t][stoi(names[i].substr(3))] += quantities[i];
+                        }
+                        acceptedOrders[t]++;
+                    }
+                    if (n % 1024 == 0 && warehouse.getStock("Sku0").value_or(0) < 0)
+                    {
+                        sawNegative = true;
+                    }
+                }
+            });
+    }
+    for (auto &worker : threads)
+    {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    bool passed = !sawNegative;
+    size_t totalAccepted = 0;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        totalAccepted += acceptedOrders[t];
+    }
+    for (int sku = 0; sku < SKU_COUNT; ++sku)
+    {
+        long long sold = 0;
+        for (int t = 0; t < threadCount; ++t)
+        {
+            sold += acceptedPerThread[t][sku];
         }
-        case 7:
-            cout << "Logging out..." << endl;
-            break;
-        default:
-            cout << "Invalid choice. Please try again." << endl;
+        int stock = warehouse.getStock("Sku" + to_string(sku)).value_or(-1);
+        if (stock < 0 || stock != INITIAL_STOCK - sold)
+        {
+            cout << "Sku" << sku << ": stock " << stock << ", expected " << (INITIAL_STOCK - sold) << endl;
+            passed = false;
         }
-    } while (choice != 7);
+    }
+    if (warehouse.getOrderCount() != totalAccepted)
+    {
+        cout << "Order history has " << warehouse.getOrderCount() << " orders, expected " << totalAccepted << endl;
+        passed = false;
+    }
+
+    cout << threadCount << " threads placed " << (size_t(threadCount) * ORDERS_PER_THREAD) << " orders ("
+         << totalAccepted << " accepted) in " << fixed << setprecision(3) << seconds << " s; hot SKU stock left: "
+         << warehouse.getStock("Sku0").value_or(-1) << endl;
+    cout << (passed ? "PASS" : "FAIL") << ": stock never oversold" << endl;
+    return passed ? 0 : 1;
 }
 
-void customerMenu(Warehouse &warehouse)
+// Synthetic Data Generator: writes inventory.txt and orders.txt into dir. The same
+// options always produce the same files. Product popularity follows a Zipf distribution
+// with exponent skew (0 = uniform); orders have 1-5 lines and are spread evenly over the
+// year before endTime. endTime defaults to a fixed date (2026-01-01 UTC) rather than the
+// clock, so the default output does not change from one day to the next.
+struct GeneratorOptions
 {
-    int choice;
-    do
+    size_t skuCount = 100000;
+    size_t orderLineCount = 1000000;
+    double skew = 1.0;
+    uint64_t seed = 42;
+    time_t endTime = 1767225600;
+};
+
+int generateData(const string &dir, const GeneratorOptions &options)
+{
+    string inventoryFile = dir + "/inventory.txt";
+    string ordersFile = dir + "/orders.txt";
+    FILE *inventoryOut = fopen(inventoryFile.c_str(), "wb");
+    FILE *ordersOut = fopen(ordersFile.c_str(), "wb");
+    if (!inventoryOut || !ordersOut)
     {
-        displayHeader("Customer Menu");
-        cout << "1. View Inventory\n";
-        cout << "2. Place Order\n";
-        cout << "3. Logout\n";
-        cout << "Enter your choice: ";
-        cin >> choice;
+        cerr << "Unable to write " << inventoryFile << " and " << ordersFile << endl;
+        if (inventoryOut)
+        {
+            fclose(inventoryOut);
+        }
+        if (ordersOut)
+        {
+            fclose(ordersOut);
+        }
+        return 1;
+    }
 
-        switch (choice)
+    mt19937_64 random(options.seed);
+    size_t skuCount = max<size_t>(1, options.skuCount);
+    auto skuName = [](size_t sku) { return "Item" + to_string(sku); };
+
+    string buffer;
+    auto flushBuffer = [&](FILE *file, size_t threshold)
+    {
+        if (buffer.size() >= threshold)
         {
-        case 1:
-            warehouse.viewInventory();
-            break;
-        case 2:
+            fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+    };
+
+    uniform_int_distribution<int> stockDist(1000, 100000);
+    uniform_int_distribution<int> centsDist(99, 99999);
+    vector<int64_t> prices(skuCount);
+    for (size_t sku = 0; sku < skuCount; ++sku)
+    {
+        prices[sku] = centsDist(random);
+        buffer += "G" + to_string(sku) + "," + skuName(sku) + "," + to_string(stockDist(random)) + "," +
+                  formatCents(prices[sku]) + "\n";
+        flushBuffer(inventoryOut, 1 << 20);
+    }
+    flushBuffer(inventoryOut, 0);
+
+    // Cumulative Zipf weights; a uniform draw is mapped to a SKU by binary search
+    vector<double> popularity(skuCount);
+    double total = 0;
+    for (size_t sku = 0; sku < skuCount; ++sku)
+    {
+        total += 1.0 / pow(double(sku + 1), options.skew);
+        popularity[sku] = total;
+    }
+    uniform_real_distribution<double> popularityDist(0, total);
+    uniform_int_distribution<int> lineDist(1, 5), qtyDist(1, 3);
+
+    const time_t YEAR_SECONDS = 365 * 24 * 60 * 60;
+    time_t end = options.endTime;
+    size_t expectedOrders = max<size_t>(1, options.orderLineCount / 3);
+    size_t linesWritten = 0, orderCount = 0;
+    while (linesWritten < options.orderLineCount)
+    {
+        time_t date = end - YEAR_SECONDS + time_t(double(YEAR_SECONDS) * min(orderCount, expectedOrders) / expectedOrders);
+        buffer += "O" + to_string(++orderCount) + "," + to_string(date);
+        int lineCount = int(min<size_t>(lineDist(random), options.orderLineCount - linesWritten));
+        for (int line = 0; line < lineCount; ++line)
         {
-            warehouse.addOrder();
-            warehouse.viewInventory();
-            break;
+            size_t sku = lower_bound(popularity.begin(), popularity.end(), popularityDist(random)) - popularity.begin();
+            sku = min(sku, skuCount - 1);
+            buffer += "|" + skuName(sku) + "," + to_string(qtyDist(random)) + "," + formatCents(prices[sku]);
         }
-        case 3:
-            cout << "Logging out..." << endl;
-            break;
-        default:
-            cout << "Invalid choice. Please try again." << endl;
+        buffer += "\n";
+        linesWritten += lineCount;
+        flushBuffer(ordersOut, 1 << 20);
+    }
+    flushBuffer(ordersOut, 0);
+
+    bool written = !ferror(inventoryOut) && !ferror(ordersOut);
+    written = (fclose(inventoryOut) == 0) && written;
+    written = (fclose(ordersOut) == 0) && written;
+    if (!written)
+    {
+        cerr << "Unable to write " << inventoryFile << " and " << ordersFile << endl;
+        return 1;
+    }
+    cout << "Generated " << skuCount << " products and " << orderCount << " orders (" << linesWritten
+         << " lines) in " << dir << endl;
+    return 0;
+}
+
+// Collects per-operation latencies for one benchmark and prints them as a JSON line:
+// {"benchmark":name,"ops":n,"seconds":s,"ops_per_sec":r,"p50_us":x,"p99_us":y}
+// where seconds is the total time spent inside the timed operations
+class BenchmarkTimer
+{
+private:
+    string name;
+    vector<double> latencies; // Microseconds
+    double totalMicros = 0;
+
+    double percentile(double fraction)
+    {
+        if (latencies.empty())
+        {
+            return 0;
         }
-    } while (choice != 3);
+        size_t rank = min(latencies.size() - 1, size_t(fraction * latencies.size()));
+        nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+        return latencies[rank];
+    }
+
+public:
+    explicit BenchmarkTimer(string name) : name(move(name))
+    {
+    }
+
+    template <typename F> void time(F f)
+    {
+        auto start = chrono::steady_clock::now();
+        f();
+        latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        totalMicros += latencies.back();
+    }
+
+    // ops overrides the operation count for single timed bulk operations such as a load
+    void report(ostream &out, size_t ops = 0)
+    {
+        double seconds = totalMicros / 1e6;
+        ops = ops ? ops : latencies.size();
+        double p50 = percentile(0.50);
+        double p99 = percentile(0.99);
+        out << fixed << setprecision(3) << "{\"benchmark\":\"" << name << "\",\"ops\":" << ops
+            << ",\"seconds\":" << seconds << ",\"ops_per_sec\":" << (seconds > 0 ? ops / seconds : 0)
+            << ",\"p50_us\":" << p50 << ",\"p99_us\":" << p99 << "}" << endl;
+    }
+};
+
+// Resident memory of this process in bytes, or 0 where /proc/self/statm is unavailable
+size_t residentBytes()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (!(statm >> totalPages >> residentPages))
+    {
+        return 0;
+    }
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Discards everything written to it; used to time reports without printing them
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+
+    streamsize xsputn(const char *, streamsize count) override
+    {
+        return count;
+    }
+};
+
+// Benchmark Suite: loads dir/inventory.txt and dir/orders.txt, then times searches,
+// sales reports and order placement. Results are printed as one JSON line per benchmark.
+// The rolling reports end at dataEndTime, the date of the newest order the generator
+// wrote, so their periods hold data whenever the benchmark runs
+int runBenchmark(const string &dir, size_t operationCount, time_t dataEndTime)
+{
+    Warehouse warehouse;
+    BenchmarkTimer loadInventory("load_inventory");
+    loadInventory.time([&] { warehouse.loadInventoryFromFile(dir + "/inventory.txt"); });
+    vector<Product> products = warehouse.getProducts();
+    loadInventory.report(cout, products.size());
+
+    BenchmarkTimer loadOrders("load_orders");
+    size_t residentBefore = residentBytes();
+    loadOrders.time([&] { warehouse.loadOrdersFromFile(dir + "/orders.txt"); });
+    loadOrders.report(cout, warehouse.getOrderCount());
+
+    // Memory the loaded order history and its analytics structures keep resident
+    size_t historyBytes = residentBytes() - min(residentBefore, residentBytes());
+    cout << "{\"benchmark\":\"order_history_memory\",\"orders\":" << warehouse.getOrderCount()
+         << ",\"resident_bytes\":" << historyBytes << ",\"bytes_per_order\":"
+         << historyBytes / max<size_t>(1, warehouse.getOrderCount()) << "}" << endl;
+
+    if (products.empty())
+    {
+        cerr << "No products loaded from " << dir << endl;
+        return 1;
+    }
+
+    mt19937_64 random(7);
+    uniform_int_distribution<size_t> productDist(0, products.size() - 1);
+
+    // Lookups by ID and by name, with one in ten missing
+    BenchmarkTimer search("search_product");
+    size_t found = 0;
+    for (size_t i = 0; i < operationCount; ++i)
+    {
+        const Product &product = products[productDist(random)];
+        string term = i % 10 == 0 ? "missing" + to_string(i) : (i % 2 ? product.getName() : product.getProductID());
+        search.time([&] { found += warehouse.searchProducts(term).size(); });
+    }
+    search.report(cout);
+
+    NullBuffer nullBuffer;
+    WeeklyReport weekly;
+    MonthlyReport monthly;
+    YearlyReport yearly;
+    pair<const char *, RollingSalesReport *> reports[] = {
+        {"weekly_report", &weekly}, {"monthly_report", &monthly}, {"yearly_report", &yearly}};
+    size_t reportRuns = max<size_t>(1, operationCount / 1000);
+    for (auto &report : reports)
+    {
+        report.second->setEndTime(dataEndTime);
+        BenchmarkTimer timer(report.first);
+        streambuf *console = cout.rdbuf(&nullBuffer);
+        for (size_t i = 0; i < reportRuns; ++i)
+        {
+            timer.time([&] { report.second->generateSalesReport(warehouse); });
+        }
+        cout.rdbuf(console);
+        timer.report(cout);
+    }
+
+    BenchmarkTimer place("place_order");
+    uniform_int_distribution<int> lineDist(1, 3);
+    string error;
+    size_t accepted = 0;
+    for (size_t i = 0; i < operationCount; ++i)
+    {
+        Order request("", time(0));
+        for (int line = lineDist(random); line > 0; --line)
+        {
+            request.addProduct(products[productDist(random)].getName(), 1);
+        }
+        place.time([&] { accepted += warehouse.placeOrder(request, error).has_value(); });
+    }
+    place.report(cout);
+
+    cerr << "Benchmark finished: " << found << " search hits, " << accepted << " orders accepted" << endl;
+    return 0;
 }
 
+void printUsage(const char *program)
+{
+    cout << "Usage: " << program << " [options]\n";
+    cout << "  --snapshot <file>         Start from a binary snapshot (falling back to the text files)\n";
+    cout << "                            and write it again on exit\n";
+    cout << "  --export-snapshot <file>  Convert inventory.txt and orders.txt to a snapshot and exit\n";
+    cout << "  --import-snapshot <file>  Convert a snapshot to inventory.txt and orders.txt and exit\n";
+    cout << "  --inventory-store <file>  Keep the inventory in a memory-mapped record file updated in\n";
+    cout << "                            place instead of inventory.txt (created from it on first use)\n";
+    cout << "  --shared-inventory <name> Share stock, the catalog and order numbers with every process\n";
+    cout << "                            started with the same name, through POSIX shared memory\n";
+    cout << "  --ingest <file|->         Place orders from a file (or stdin) without the menus and exit\n";
+    cout << "  --ingest-output <file>    Where --ingest writes per-order results (default ingest_results.txt)\n";
+    cout << "  --threads <n>             Place --ingest orders on a pool of n worker threads, or run\n";
+    cout << "                            --listen requests on n workers (default 4)\n";
+    cout << "  --serve                   Answer line-based commands (ORDER, STOCK, REPORT, ...) on\n";
+    cout << "                            stdin/stdout instead of showing the menus; send HELP for a list\n";
+    cout << "  --listen <[host:]port>    Answer the --serve commands over TCP until interrupted (host\n";
+    cout << "                            defaults to 127.0.0.1; \":port\" listens on every interface)\n";
+    cout << "  --load-test <[host:]port> Send requests to a --listen server and print requests per\n";
+    cout << "                            second and latency percentiles as JSON, then exit\n";
+    cout << "    --load-connections <n>  Concurrent connections, one request in flight each (default 8)\n";
+    cout << "    --load-ops <n>          Requests to send (default 100000)\n";
+    cout << "    --load-requests <file>  Request lines to send in turn (default: STOCK and ORDER of\n";
+    cout << "                            the products --generate writes, sized by --skus)\n";
+    cout << "  --top <k>                 Rows in the sales reports' top sellers tables (default 5)\n";
+    cout << "  --track-top <capacity>    Track all-time best sellers approximately in bounded memory\n";
+    cout << "  --approximate             Keep fixed-size sketches of the last year's sales and base the\n";
+    cout << "                            sales reports on them\n";
+    cout << "  --report-threads <n>      Threads used to sum sales for reports (default: all cores)\n";
+    cout << "  --stress-test [threads]   Check concurrent stock reservation for overselling and exit\n";
+    cout << "  --stats                   Print operation counts and latencies to stderr on exit\n";
+    cout << "  --stats-json <file>       Write operation counts and latencies as JSON on exit\n";
+    cout << "  --generate <dir>          Write synthetic inventory.txt and orders.txt into dir and exit\n";
+    cout << "    --skus <n>              Number of products to generate (default 100000)\n";
+    cout << "    --order-lines <n>       Number of order lines to generate (default 1000000)\n";
+    cout << "    --skew <s>              Zipf exponent of product popularity, 0 for uniform (default 1.0)\n";
+    cout << "    --seed <n>              Random seed (default 42)\n";
+    cout << "    --end-time <epoch>      Date of the newest order (default 1767225600, 2026-01-01 UTC);\n";
+    cout << "                            --benchmark's weekly, monthly and yearly reports end there too\n";
+    cout << "  --benchmark <dir>         Time loading, searches, reports and orders on dir's data files,\n";
+    cout << "                            printing one JSON line per benchmark, and exit\n";
+    cout << "    --benchmark-ops <n>     Searches and orders to time (default 100000)\n";
+}
+
+// Dumps the collected statistics when main returns, whichever mode it ran
+struct StatsDump
+{
+    bool printText = false;
+    string jsonFile;
+
+    ~StatsDump()
+    {
+        if (!printText && jsonFile.empty())
+        {
+            return;
+        }
+        StatsSnapshot snapshot = Stats::collect();
+        if (printText)
+        {
+            snapshot.printText(cerr);
+        }
+        if (!jsonFile.empty())
+        {
+            ofstream outFile(jsonFile);
+            if (!outFile.is_open())
+            {
+                cerr << "Unable to open " << jsonFile << " for writing." << endl;
+                return;
+            }
+            snapshot.printJSON(outFile);
+        }
+    }
+};
+
 // Main Function
-int main()
+int main(int argc, char *argv[])
 {
+    StatsDump statsDump;
+    string snapshotFile, exportSnapshotFile, importSnapshotFile, inventoryStoreFile, sharedInventoryName;
+    string ingestFile, ingestOutputFile = "ingest_results.txt";
+    size_t ingestThreads = 0;
+    string generateDir, benchmarkDir;
+    GeneratorOptions generatorOptions;
+    size_t benchmarkOps = 100000;
+    int stressThreads = 0;
+    bool serve = false;
+    string listenEndpoint, loadTestEndpoint, loadRequestsFile;
+    size_t loadConnections = 8, loadOps = 100000;
+    size_t trackTopCapacity = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--snapshot" && i + 1 < argc)
+        {
+            snapshotFile = argv[++i];
+        }
+        else if (arg == "--export-snapshot" && i + 1 < argc)
+        {
+            exportSnapshotFile = argv[++i];
+        }
+        else if (arg == "--import-snapshot" && i + 1 < argc)
+        {
+            importSnapshotFile = argv[++i];
+        }
+        else if (arg == "--inventory-store" && i + 1 < argc)
+        {
+            inventoryStoreFile = argv[++i];
+        }
+        else if (arg == "--shared-inventory" && i + 1 < argc)
+        {
+            sharedInventoryName = argv[++i];
+        }
+        else if (arg == "--ingest" && i + 1 < argc)
+        {
+            ingestFile = argv[++i];
+        }
+        else if (arg == "--ingest-output" && i + 1 < argc)
+        {
+            ingestOutputFile = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            ingestThreads = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--generate" && i + 1 < argc)
+        {
+            generateDir = argv[++i];
+        }
+        else if (arg == "--skus" && i + 1 < argc)
+        {
+            generatorOptions.skuCount = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--order-lines" && i + 1 < argc)
+        {
+            generatorOptions.orderLineCount = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--skew" && i + 1 < argc)
+        {
+            generatorOptions.skew = atof(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            generatorOptions.seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--end-time" && i + 1 < argc)
+        {
+            generatorOptions.endTime = static_cast<time_t>(strtoll(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--benchmark" && i + 1 < argc)
+        {
+            benchmarkDir = argv[++i];
+        }
+        else if (arg == "--benchmark-ops" && i + 1 < argc)
+        {
+            benchmarkOps = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--top" && i + 1 < argc)
+        {
+            SalesReport::topCount = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--track-top" && i + 1 < argc)
+        {
+            trackTopCapacity = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--report-threads" && i + 1 < argc)
+        {
+            OrderLineStore::aggregationThreads = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--approximate")
+        {
+            SalesReport::approximate = true;
+        }
+        else if (arg == "--serve")
+        {
+            serve = true;
+        }
+        else if (arg == "--listen" && i + 1 < argc)
+        {
+            listenEndpoint = argv[++i];
+        }
+        else if (arg == "--load-test" && i + 1 < argc)
+        {
+            loadTestEndpoint = argv[++i];
+        }
+        else if (arg == "--load-connections" && i + 1 < argc)
+        {
+            loadConnections = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--load-ops" && i + 1 < argc)
+        {
+            loadOps = max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--load-requests" && i + 1 < argc)
+        {
+            loadRequestsFile = argv[++i];
+        }
+        else if (arg == "--stats")
+        {
+            statsDump.printText = true;
+        }
+        else if (arg == "--stats-json" && i + 1 < argc)
+        {
+            statsDump.jsonFile = argv[++i];
+        }
+        else if (arg == "--stress-test")
+        {
+            stressThreads = max(2u, thread::hardware_concurrency());
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                stressThreads = max(1, atoi(argv[++i]));
+            }
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (stressThreads > 0)
+    {
+        return runStressTest(stressThreads);
+    }
+    if (!loadTestEndpoint.empty())
+    {
+        return runLoadTest(loadTestEndpoint, loadRequestsFile, loadConnections, loadOps, generatorOptions.skuCount);
+    }
+    if (!generateDir.empty())
+    {
+        int status = generateData(generateDir, generatorOptions);
+        if (status != 0 || benchmarkDir.empty())
+        {
+            return status;
+        }
+    }
+    if (!benchmarkDir.empty())
+    {
+        return runBenchmark(benchmarkDir, benchmarkOps, generatorOptions.endTime);
+    }
+
     Warehouse warehouse;
-    warehouse.loadInventoryFromFile("inventory.txt");
-    warehouse.loadOrdersFromFile("orders.txt");
+    warehouse.trackTopSellers(trackTopCapacity);
+    if (SalesReport::approximate)
+    {
+        warehouse.trackApproximateSales();
+    }
+    if (!importSnapshotFile.empty())
+    {
+        if (!warehouse.loadSnapshot(importSnapshotFile))
+        {
+            cerr << "Unable to load snapshot " << importSnapshotFile << endl;
+            return 1;
+        }
+        warehouse.saveInventoryToFile("inventory.txt");
+        warehouse.saveOrdersToFile("orders.txt");
+        cout << "Converted " << importSnapshotFile << " to inventory.txt and orders.txt" << endl;
+        return 0;
+    }
+
+    DataFiles dataFiles;
+    dataFiles.snapshot = snapshotFile;
+    if (!sharedInventoryName.empty())
+    {
+        // The shared segment is the live copy of the inventory; a snapshot or store would
+        // be a second one
+        if (!snapshotFile.empty() || !exportSnapshotFile.empty() || !inventoryStoreFile.empty())
+        {
+            cerr << "--shared-inventory cannot be combined with snapshots or --inventory-store." << endl;
+            return 1;
+        }
+        if (!warehouse.shareInventory(sharedInventoryName, dataFiles))
+        {
+            return 1;
+        }
+    }
+    if (!inventoryStoreFile.empty())
+    {
+        // A snapshot carries its own copy of the inventory, which the store would contradict
+        if (!snapshotFile.empty() || !exportSnapshotFile.empty())
+        {
+            cerr << "--inventory-store cannot be combined with snapshots." << endl;
+            return 1;
+        }
+        if (!warehouse.openInventoryStore(inventoryStoreFile, dataFiles.inventory))
+        {
+            return 1;
+        }
+        warehouse.loadOrdersFromFile(dataFiles.orders);
+    }
+    else if (snapshotFile.empty() || !warehouse.loadSnapshot(snapshotFile))
+    {
+        warehouse.loadInventoryFromFile(dataFiles.inventory);
+        warehouse.loadOrdersFromFile(dataFiles.orders);
+    }
+
+    if (!exportSnapshotFile.empty())
+    {
+        if (!warehouse.saveSnapshot(exportSnapshotFile))
+        {
+            return 1;
+        }
+        cout << "Converted inventory.txt and orders.txt to " << exportSnapshotFile << endl;
+        return 0;
+    }
+    warehouse.openJournal(dataFiles);
+
+    if (!ingestFile.empty())
+    {
+        return ingestOrders(warehouse, ingestFile, ingestOutputFile, ingestThreads);
+    }
+    if (!listenEndpoint.empty())
+    {
+        return serveTcp(warehouse, listenEndpoint, ingestThreads ? ingestThreads : DEFAULT_LISTEN_THREADS);
+    }
+    if (serve)
+    {
+        ios::sync_with_stdio(false);
+        cin.tie(nullptr);
+        return serveCommands(warehouse, cin, cout);
+    }
 
     int choice;
     do
@@ -1098,8 +8305,7 @@ int main()
             }
             break;
         case 5:
-            warehouse.saveInventoryToFile("inventory.txt");
-            warehouse.saveOrdersToFile("orders.txt");
+            warehouse.compact();
             cout << "Exiting the program. Thank you!" << endl;
             break;
         default: